@@ -0,0 +1,79 @@
+#include <uWS/uWS.h>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/HTTPRequest.h"
+#include "../src/HTTPRouter.h"
+
+namespace rustla2 {
+
+namespace {
+
+constexpr uWS::HttpMethod GET = uWS::HttpMethod::METHOD_GET;
+
+const uint64_t kIterations = 1000000;
+
+std::string GetStaticPath(const size_t i) {
+  return "/assets/" + std::to_string(i) + "/bundle." + std::to_string(i) +
+         ".js";
+}
+
+/**
+ * Report the mean cost of routing |paths| round robin through a router with
+ * |route_count| static file routes plus the API's wildcard routes.
+ */
+void BenchmarkDispatch(const std::string &name, const size_t route_count,
+                       const std::vector<std::string> &paths) {
+  HTTPRouter router;
+  uint64_t count = 0;
+  auto handler = [&](uWS::HttpResponse *res, HTTPRequest *req) { ++count; };
+
+  for (size_t i = 0; i < route_count; ++i) {
+    router.Get(GetStaticPath(i), handler);
+  }
+  router.Get("/api", handler);
+  router.Get("/api/streamer/*", handler);
+  router.Get("/api/profile", handler);
+  router.Post("/api/profile", handler);
+  router.Delete("/admin/user-bans/*", handler);
+
+  std::vector<folly::StringPiece> pieces(paths.begin(), paths.end());
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < kIterations; ++i) {
+    const auto route = router.Find(pieces[i % pieces.size()], GET);
+    if (route != nullptr) {
+      (*route)(nullptr, nullptr);
+    }
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  const auto ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  std::cout << name << " routes=" << route_count
+            << " ns/dispatch=" << static_cast<double>(ns) / kIterations
+            << " matched=" << count << std::endl;
+}
+
+}  // namespace
+
+}  // namespace rustla2
+
+int main(int argc, char **argv) {
+  for (const size_t route_count : {10, 100, 1000, 10000}) {
+    std::vector<std::string> static_paths;
+    for (size_t i = 0; i < route_count; i += route_count / 10) {
+      static_paths.push_back(rustla2::GetStaticPath(i));
+    }
+
+    rustla2::BenchmarkDispatch("static", route_count, static_paths);
+    rustla2::BenchmarkDispatch("wildcard", route_count,
+                               {"/api/streamer/destiny"});
+    rustla2::BenchmarkDispatch("miss", route_count, {"/not/a/route"});
+  }
+
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include <sqlite_modern_cpp.h>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "../src/PreparedStatements.h"
+
+namespace rustla2 {
+
+namespace {
+
+const uint64_t kRows = 1000;
+
+const uint64_t kIterations = 200000;
+
+// the statement Stream::WriteUpdate runs after a poll
+const char kUpdateSQL[] = R"sql(
+    UPDATE `streams` SET
+      `thumbnail` = ?,
+      `is_live` = ?,
+      `viewers` = ?,
+      `updated_at` = datetime()
+    WHERE `id` = ?
+  )sql";
+
+void CreateTable(sqlite::database db) {
+  db << R"sql(
+      CREATE TABLE `streams` (
+        `id` INTEGER PRIMARY KEY,
+        `thumbnail` VARCHAR(255),
+        `is_live` TINYINT(1) DEFAULT 0,
+        `viewers` INTEGER DEFAULT 0,
+        `updated_at` DATETIME
+      );
+    )sql";
+
+  db << "BEGIN;";
+  for (uint64_t i = 0; i < kRows; ++i) {
+    db << "INSERT INTO `streams` (`id`) VALUES (?);" << i;
+  }
+  db << "COMMIT;";
+}
+
+/**
+ * Report the mean cost of an update using |save|, batched into transactions
+ * the way DBWriter flushes them.
+ */
+template <typename F>
+void BenchmarkSave(const std::string &name, sqlite::database db, F save) {
+  const auto start = std::chrono::steady_clock::now();
+  db << "BEGIN;";
+  for (uint64_t i = 0; i < kIterations; ++i) {
+    save(i);
+  }
+  db << "COMMIT;";
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  const auto ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  std::cout << name << " ns/save=" << static_cast<double>(ns) / kIterations
+            << " saves/s=" << kIterations * 1e9 / ns << std::endl;
+}
+
+}  // namespace
+
+}  // namespace rustla2
+
+int main(int argc, char **argv) {
+  sqlite::database db(":memory:");
+  rustla2::CreateTable(db);
+  const std::string thumbnail = "https://example.com/thumbnail.jpg";
+
+  rustla2::BenchmarkSave("uncached", db, [&](const uint64_t i) {
+    db << rustla2::kUpdateSQL << thumbnail << (i % 2 == 0) << i
+       << i % rustla2::kRows;
+  });
+
+  rustla2::PreparedStatements statements(db);
+  rustla2::BenchmarkSave("prepared", db, [&](const uint64_t i) {
+    auto query = statements.Get(rustla2::kUpdateSQL);
+    query << thumbnail << (i % 2 == 0) << i << i % rustla2::kRows;
+    query.Execute();
+  });
+
+  return 0;
+}
@@ -2,6 +2,7 @@
 
 #include <cxxabi.h>
 #include <folly/Format.h>
+#include <utility>
 
 #include "JSON.h"
 #include "Status.h"
@@ -11,7 +12,20 @@ namespace rustla2 {
 Status APIResult::SetData(const char* data, size_t length) {
   Status status;
   data_ = json::Parse(data, length, GetSchema(), &status);
+  return GetStatus(status);
+}
+
+Status APIResult::SetData(std::string&& data) {
+  // the old document may point into the old buffer so is replaced first
+  data_.SetNull();
+  buffer_ = std::move(data);
+
+  Status status;
+  data_ = json::ParseInsitu(&buffer_[0], GetSchema(), &status);
+  return GetStatus(status);
+}
 
+Status APIResult::GetStatus(const Status& status) {
   if (status.Ok()) return status;
 
   int demangle_error;
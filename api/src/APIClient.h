@@ -18,7 +18,17 @@ class APIResult {
 
   Status SetData(const char* data, size_t length);
 
+  /**
+   * Take ownership of |data| and parse it in place, without copying its
+   * strings into the document.
+   */
+  Status SetData(std::string&& data);
+
  private:
+  Status GetStatus(const Status& status);
+
+  // backs the strings of a document parsed in place
+  std::string buffer_;
   rapidjson::Document data_;
 };
 
@@ -18,13 +18,19 @@ void APIHTTPService::RegisterRoutes(HTTPRouter *router) {
 }
 
 void APIHTTPService::GetAPI(uWS::HttpResponse *res, HTTPRequest *req) {
-  HTTPResponseWriter writer(res);
+  auto response = broadcaster_->GetAPIResponse();
+  if (response != nullptr) {
+    response->Write(res, req);
+    return;
+  }
+
+  HTTPResponseWriter writer(res, req->GetResponseOptions());
   writer.Status(200, "OK");
   writer.JSON(db_->GetStreams()->GetAPIJSON());
 }
 
 void APIHTTPService::GetStreamer(uWS::HttpResponse *res, HTTPRequest *req) {
-  HTTPResponseWriter writer(res);
+  HTTPResponseWriter writer(res, req->GetResponseOptions());
 
   auto user = db_->GetUsers()->GetByName(req->GetPathPart(3).toString());
   if (user == nullptr) {
@@ -37,7 +43,7 @@ void APIHTTPService::GetStreamer(uWS::HttpResponse *res, HTTPRequest *req) {
 }
 
 void APIHTTPService::GetProfile(uWS::HttpResponse *res, HTTPRequest *req) {
-  HTTPResponseWriter writer(res);
+  HTTPResponseWriter writer(res, req->GetResponseOptions());
 
   const auto name = req->GetSessionID();
   auto user = db_->GetUsers()->GetByName(name);
@@ -55,14 +61,15 @@ void APIHTTPService::PostProfile(uWS::HttpResponse *res, HTTPRequest *req) {
   auto user = name == "" ? nullptr : db_->GetUsers()->GetByName(name);
 
   if (user == nullptr) {
-    HTTPResponseWriter writer(res);
+    HTTPResponseWriter writer(res, req->GetResponseOptions());
     writer.Status(401, "Unauthorized");
     writer.JSON("{\"error\": \"unauthorized\"}");
     return;
   }
 
+  const auto options = req->GetResponseOptions();
   req->OnPostData([=](const char *data, const size_t length) {
-    HTTPResponseWriter writer(res);
+    HTTPResponseWriter writer(res, options);
     Status status;
 
     const auto schema = R"json(
@@ -98,7 +105,8 @@ void APIHTTPService::PostProfile(uWS::HttpResponse *res, HTTPRequest *req) {
       user->SetLeftChat(input["left_chat"].GetBool());
     }
 
-    if (!user->Save()) {
+    // written before responding so failures can be reported to the client
+    if (!user->SaveNow()) {
       writer.Status(500, "Internal Error");
       writer.JSON("{\"error\": \"error saving changes\"}");
       return;
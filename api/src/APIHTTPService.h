@@ -3,6 +3,7 @@
 #include <rapidjson/document.h>
 #include <memory>
 
+#include "Broadcaster.h"
 #include "DB.h"
 #include "HTTPRequest.h"
 #include "HTTPRouter.h"
@@ -11,7 +12,9 @@ namespace rustla2 {
 
 class APIHTTPService {
  public:
-  explicit APIHTTPService(std::shared_ptr<DB> db) : db_(db) {}
+  APIHTTPService(std::shared_ptr<DB> db,
+                 std::shared_ptr<Broadcaster> broadcaster)
+      : db_(db), broadcaster_(broadcaster) {}
 
   void RegisterRoutes(HTTPRouter *router);
 
@@ -25,6 +28,7 @@ class APIHTTPService {
 
  private:
   std::shared_ptr<DB> db_;
+  std::shared_ptr<Broadcaster> broadcaster_;
 };
 
 }  // namespace rustla2
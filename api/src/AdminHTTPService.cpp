@@ -40,7 +40,7 @@ void AdminHTTPService::GetUsers(uWS::HttpResponse *res, HTTPRequest *req) {
     return;
   }
 
-  HTTPResponseWriter writer(res);
+  HTTPResponseWriter writer(res, req->GetResponseOptions());
   writer.Status(200, "OK");
   writer.JSON(json::Serialize(db_->GetUsers()));
 }
@@ -52,7 +52,7 @@ HTTPRouteHandler AdminHTTPService::GetHandler(T collection) {
       return;
     }
 
-    HTTPResponseWriter writer(res);
+    HTTPResponseWriter writer(res, req->GetResponseOptions());
     writer.Status(200, "OK");
     writer.JSON(json::Serialize(collection));
   };
@@ -65,8 +65,9 @@ HTTPRouteHandler AdminHTTPService::CreateBanHandler(T collection) {
       return;
     }
 
+    const auto options = req->GetResponseOptions();
     req->OnPostData([=](const char *data, const size_t length) {
-      HTTPResponseWriter writer(res);
+      HTTPResponseWriter writer(res, options);
       Status status;
 
       const auto schema = R"json(
@@ -102,8 +103,9 @@ void AdminHTTPService::CreateIPBan(uWS::HttpResponse *res, HTTPRequest *req) {
     return;
   }
 
+  const auto options = req->GetResponseOptions();
   req->OnPostData([=](const char *data, const size_t length) {
-    HTTPResponseWriter writer(res);
+    HTTPResponseWriter writer(res, options);
     Status status;
 
     const auto schema = R"json(
@@ -211,7 +213,7 @@ void AdminHTTPService::CreateBan(const uint64_t entry_id,
 template <typename T>
 HTTPRouteHandler AdminHTTPService::DeleteBanHandler(T collection) {
   return [=](uWS::HttpResponse *res, HTTPRequest *req) {
-    HTTPResponseWriter writer(res);
+    HTTPResponseWriter writer(res, req->GetResponseOptions());
     Status status;
 
     auto id = std::stoull(req->GetPathPart(3).toString());
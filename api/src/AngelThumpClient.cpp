@@ -47,8 +47,7 @@ Status Client::GetChannelByName(const std::string& name,
         "api returned status code " + std::to_string(req.GetResponseCode()));
   }
 
-  const auto& response = req.GetResponse();
-  return result->SetData(response.c_str(), response.size());
+  return result->SetData(req.TakeResponse());
 }
 
 }  // namespace angelthump
@@ -29,14 +29,14 @@ void AuthHTTPService::GetLogin(uWS::HttpResponse *res, HTTPRequest *req) {
       << "&client_id=" << Config::Get().GetTwitchClientID()
       << "&redirect_uri=" << Config::Get().GetTwitchRedirectURL();
 
-  HTTPResponseWriter writer(res);
+  HTTPResponseWriter writer(res, req->GetResponseOptions());
   writer.Status(302, "Found");
   writer.Header("Location", url.str());
   writer.Body();
 }
 
 void AuthHTTPService::GetOAuth(uWS::HttpResponse *res, HTTPRequest *req) {
-  HTTPResponseWriter writer(res);
+  HTTPResponseWriter writer(res, req->GetResponseOptions());
 
   const auto query_params = req->GetQueryParams();
   auto code = query_params.find("code");
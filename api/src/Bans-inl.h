@@ -56,13 +56,19 @@ Status BanMediator<T>::SetIsBanned(const uint64_t entry_id,
 }
 
 template <typename TCollection, typename TBanMediator>
-Bans<TCollection, TBanMediator>::Bans(sqlite::database db,
-                                      const std::string& table_name,
-                                      std::shared_ptr<TCollection> collection)
-    : db_(db), table_name_(table_name), collection_(collection) {
+Bans<TCollection, TBanMediator>::Bans(
+    sqlite::database db, sqlite::database reader,
+    std::shared_ptr<PreparedStatements> statements,
+    std::shared_ptr<DBWriter> writer, const std::string& table_name,
+    std::shared_ptr<TCollection> collection)
+    : db_(db),
+      statements_(statements),
+      writer_(writer),
+      table_name_(table_name),
+      collection_(collection) {
   InitTable();
 
-  db_ << folly::sformat("SELECT MAX(id) + 1 FROM {}", table_name_) >>
+  reader << folly::sformat("SELECT MAX(id) + 1 FROM {}", table_name_) >>
       [&](uint64_t next_id) { next_id_ = next_id; };
 
   const auto sql = R"sql(
@@ -75,12 +81,12 @@ Bans<TCollection, TBanMediator>::Bans(sqlite::database db,
       WHERE `is_active` = 1
       ORDER BY `expiry_time` DESC
     )sql";
-  auto query = db_ << folly::sformat(sql, table_name_);
+  auto query = reader << folly::sformat(sql, table_name_);
 
   query >> [&](const uint64_t id, const uint64_t entry_id,
                const uint64_t expiry_time, const std::string& note) {
-    Insert(std::make_shared<Ban>(db_, table_name_, id, entry_id, expiry_time,
-                                 note));
+    Insert(std::make_shared<Ban>(statements_, writer_, table_name_, id,
+                                 entry_id, expiry_time, note));
   };
 
   LOG(INFO) << "read " << Size() << " bans from " << table_name_;
@@ -120,8 +126,8 @@ template <typename TCollection, typename TBanMediator>
 std::shared_ptr<Ban> Bans<TCollection, TBanMediator>::Emplace(
     const uint64_t entry_id, const time_t expiry_time, const std::string& note,
     Status* status) {
-  auto ban = std::make_shared<Ban>(db_, table_name_, GetNextID(), entry_id,
-                                   expiry_time, note);
+  auto ban = std::make_shared<Ban>(statements_, writer_, table_name_,
+                                   GetNextID(), entry_id, expiry_time, note);
 
   auto ban_status = TBanMediator::Ban(collection_, ban);
   if (!ban_status.Ok()) {
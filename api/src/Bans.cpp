@@ -4,6 +4,7 @@ namespace rustla2 {
 
 Status Ban::SaveNew() {
   boost::upgrade_lock<boost::shared_mutex> read_lock(lock_);
+  auto connection_lock = writer_->LockConnection();
 
   try {
     const auto sql = R"sql(
@@ -26,8 +27,9 @@ Status Ban::SaveNew() {
           datetime()
         );
       )sql";
-    auto query = db_ << folly::sformat(sql, table_name_) << id_ << entry_id_
-                     << expiry_time_ << note_ << is_active_;
+    auto query = statements_->Get(folly::sformat(sql, table_name_));
+    query << id_ << entry_id_ << expiry_time_ << note_ << is_active_;
+    query.Execute();
   } catch (const sqlite::sqlite_exception& e) {
     LOG(ERROR) << "error storing ban "
                << "id: " << id_ << ", "
@@ -45,6 +47,7 @@ Status Ban::SaveNew() {
 
 Status Ban::Save() {
   boost::shared_lock<boost::shared_mutex> read_lock(lock_);
+  auto connection_lock = writer_->LockConnection();
 
   try {
     const auto sql = R"sql(
@@ -56,8 +59,9 @@ Status Ban::Save() {
         `updated_at` = datetime()
         WHERE `id` = ?
       )sql";
-    db_ << folly::sformat(sql, table_name_) << entry_id_ << expiry_time_
-        << note_ << is_active_ << id_;
+    auto query = statements_->Get(folly::sformat(sql, table_name_));
+    query << entry_id_ << expiry_time_ << note_ << is_active_ << id_;
+    query.Execute();
   } catch (const sqlite::sqlite_exception& e) {
     LOG(ERROR) << "error expiring ban "
                << "entry_id: " << entry_id_ << ", "
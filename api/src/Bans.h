@@ -11,16 +11,20 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "DBWriter.h"
+#include "PreparedStatements.h"
 #include "Status.h"
 
 namespace rustla2 {
 
 class Ban {
  public:
-  Ban(sqlite::database db, const std::string& table_name, const uint64_t id,
-      const uint64_t entry_id, const time_t expiry_time,
+  Ban(std::shared_ptr<PreparedStatements> statements,
+      std::shared_ptr<DBWriter> writer, const std::string& table_name,
+      const uint64_t id, const uint64_t entry_id, const time_t expiry_time,
       const std::string& note)
-      : db_(db),
+      : statements_(statements),
+        writer_(writer),
         table_name_(table_name),
         id_(id),
         entry_id_(entry_id),
@@ -74,12 +78,15 @@ class Ban {
     is_active_ = is_active;
   }
 
+  // Bans are written inline, rather than queued on the DBWriter, so their
+  // callers can report failures.
   Status SaveNew();
 
   Status Save();
 
  private:
-  sqlite::database db_;
+  std::shared_ptr<PreparedStatements> statements_;
+  std::shared_ptr<DBWriter> writer_;
   const std::string& table_name_;
   boost::shared_mutex lock_;
   uint64_t id_{0};
@@ -115,7 +122,10 @@ template <typename TCollection,
           typename TBanMediator = BanMediator<TCollection>>
 class Bans {
  public:
-  Bans(sqlite::database db, const std::string& table_name,
+  // Existing bans are read through |reader|.
+  Bans(sqlite::database db, sqlite::database reader,
+       std::shared_ptr<PreparedStatements> statements,
+       std::shared_ptr<DBWriter> writer, const std::string& table_name,
        std::shared_ptr<TCollection> collection);
 
   bool Contains(const uint64_t entry_id) {
@@ -153,6 +163,8 @@ class Bans {
   uint64_t GetNextID() { return next_id_++; }
 
   sqlite::database db_;
+  std::shared_ptr<PreparedStatements> statements_;
+  std::shared_ptr<DBWriter> writer_;
   const std::string table_name_;
   std::shared_ptr<TCollection> collection_;
   std::atomic<uint64_t> next_id_{0};
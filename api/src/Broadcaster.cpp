@@ -0,0 +1,196 @@
+#include "Broadcaster.h"
+
+#include <folly/Format.h>
+#include <chrono>
+#include <ctime>
+
+#include "Config.h"
+
+namespace rustla2 {
+
+namespace {
+
+const uint32_t kBroadcastQueueSize = 1024;
+
+// messages smaller than this rarely shrink enough to be worth compressing
+const size_t kDeflateMinSize = 256;
+
+}  // namespace
+
+Broadcaster::Broadcaster(std::shared_ptr<DB> db)
+    : db_(db),
+      start_time_(std::time(nullptr)),
+      compression_(Config::Get().GetWSCompression()) {}
+
+std::shared_ptr<BroadcastQueue> Broadcaster::Subscribe() {
+  auto queue = std::make_shared<BroadcastQueue>(kBroadcastQueueSize);
+
+  std::lock_guard<std::mutex> lock(subscribers_lock_);
+  subscribers_.push_back(queue);
+
+  return queue;
+}
+
+/**
+ * Append a message to |broadcast|. Compression happens here, once per message,
+ * rather than once per socket when the message is sent.
+ */
+void Broadcaster::AddMessage(Broadcast *broadcast, const char *data,
+                             const size_t length,
+                             const uint32_t required_capabilities,
+                             const uint32_t excluded_capabilities) {
+  broadcast->messages.emplace_back(data, length, required_capabilities,
+                                   excluded_capabilities);
+
+  if (compression_ && length >= kDeflateMinSize) {
+    auto &message = broadcast->messages.back();
+    if (!deflater_.Deflate(data, length, &message.deflated) ||
+        message.deflated.size() >= length) {
+      message.deflated.clear();
+    }
+  }
+}
+
+void Broadcaster::Publish(std::shared_ptr<const Broadcast> broadcast) {
+  std::lock_guard<std::mutex> lock(subscribers_lock_);
+  for (const auto &queue : subscribers_) {
+    queue->Write(broadcast);
+  }
+}
+
+/**
+ * Generate STREAMS_SET broadcasts. Syncs updates from upstream services
+ * ie. liveness, thumbnail, and viewer count.
+ *
+ * The GET /api response is rendered here as well, and again whenever
+ * rustler counts change, so it's built once per change rather than once per
+ * request.
+ *
+ * Clients that negotiated STREAMS_PATCH receive only the entries that changed
+ * since the previous sequence number and request a full STREAMS_SET with
+ * `getStreams` if they detect a gap.
+ */
+void Broadcaster::BroadcastStreams() {
+  // if the list hasn't changed don't rebroadcast it
+  const auto streams = db_->GetStreams()->GetAllWithRustlersSorted();
+  if (!streams_delta_.Update(streams)) {
+    return;
+  }
+
+  auto broadcast = std::make_shared<Broadcast>();
+
+  buf_.Clear();
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buf_);
+  streams_delta_.WriteStreamsSetJSON(&writer);
+  broadcast->streams_set =
+      std::make_shared<const std::string>(buf_.GetString(), buf_.GetSize());
+  AddMessage(broadcast.get(), buf_.GetString(), buf_.GetSize(), 0,
+             WSCapability::STREAMS_PATCH);
+
+  buf_.Clear();
+  writer.Reset(buf_);
+  streams_delta_.WriteStreamsPatchJSON(&writer);
+  AddMessage(broadcast.get(), buf_.GetString(), buf_.GetSize(),
+             WSCapability::STREAMS_PATCH);
+
+  std::atomic_store(&streams_set_, broadcast->streams_set);
+  Publish(broadcast);
+
+  UpdateAPIResponse(streams);
+}
+
+void Broadcaster::UpdateAPIResponse(
+    const std::vector<std::shared_ptr<Stream>> &streams) {
+  const auto etag =
+      folly::sformat("\"{:x}-{:x}\"", start_time_, ++api_version_);
+  std::atomic_store(&api_response_,
+                    std::shared_ptr<const CachedHTTPResponse>(
+                        std::make_shared<CachedHTTPResponse>(
+                            Streams::GetAPIJSON(streams), "application/json",
+                            etag, std::time(nullptr))));
+}
+
+/**
+ * Generate RUSTLERS_SET broadcasts for any streams whose rustler counts
+ * changed recently. Handling this in a polling loop reduces the cost of
+ * syncing clients by debouncing updates and creates a knob for load shedding.
+ *
+ * Clients that negotiated RUSTLERS_BATCH receive every change from the tick in
+ * a single message instead of one message per stream:
+ * ["RUSTLERS_BATCH", [[id, rustlers], ...], [reset streams...]]
+ */
+void Broadcaster::BroadcastRustlers() {
+  auto last_rustler_broadcast_time =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+  auto streams = db_->GetStreams()->TakeUpdated();
+
+  if (!streams.empty()) {
+    auto broadcast = std::make_shared<Broadcast>();
+    broadcast->messages.reserve(streams.size() + 1);
+
+    rapidjson::StringBuffer counts_buf;
+    rapidjson::Writer<rapidjson::StringBuffer> counts(counts_buf);
+    rapidjson::StringBuffer resets_buf;
+    rapidjson::Writer<rapidjson::StringBuffer> resets(resets_buf);
+    counts.StartArray();
+    resets.StartArray();
+
+    for (const auto &stream : streams) {
+      buf_.Clear();
+      rapidjson::Writer<rapidjson::StringBuffer> writer(buf_);
+      writer.StartArray();
+
+      // If the stream was reset since the last RUSTLERS_SET broadcast it's
+      // a safe bet clients haven't received it via STREAMS_SET. Rather than
+      // broadcasting the id and triggering a flood of `getStream` requests
+      // broadcast the change as a STREAM_GET.
+      if (stream->GetResetTime() >= last_rustler_broadcast_time_) {
+        writer.String("STREAM_GET");
+        stream->WriteJSON(&writer);
+        stream->WriteJSON(&resets);
+      } else {
+        const auto id = stream->GetID();
+        const auto rustler_count = stream->GetRustlerCount();
+
+        writer.String("RUSTLERS_SET");
+        writer.Uint64(id);
+        writer.Uint64(rustler_count);
+
+        counts.StartArray();
+        counts.Uint64(id);
+        counts.Uint64(rustler_count);
+        counts.EndArray();
+      }
+
+      writer.EndArray();
+      AddMessage(broadcast.get(), buf_.GetString(), buf_.GetSize(), 0,
+                 WSCapability::RUSTLERS_BATCH);
+    }
+
+    counts.EndArray();
+    resets.EndArray();
+
+    buf_.Clear();
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buf_);
+    writer.StartArray();
+    writer.String("RUSTLERS_BATCH");
+    writer.RawValue(counts_buf.GetString(), counts_buf.GetSize(),
+                    rapidjson::kArrayType);
+    writer.RawValue(resets_buf.GetString(), resets_buf.GetSize(),
+                    rapidjson::kArrayType);
+    writer.EndArray();
+    AddMessage(broadcast.get(), buf_.GetString(), buf_.GetSize(),
+               WSCapability::RUSTLERS_BATCH);
+
+    Publish(broadcast);
+
+    // /api reports rustler counts, so it's stale as soon as they change
+    UpdateAPIResponse(db_->GetStreams()->GetAllWithRustlersSorted());
+  }
+
+  last_rustler_broadcast_time_ = last_rustler_broadcast_time;
+}
+
+}  // namespace rustla2
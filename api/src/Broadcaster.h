@@ -0,0 +1,137 @@
+#pragma once
+
+#include <folly/ProducerConsumerQueue.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "CachedHTTPResponse.h"
+#include "Compression.h"
+#include "DB.h"
+#include "StreamsDelta.h"
+
+namespace rustla2 {
+
+enum WSCapability : uint32_t {
+  STREAMS_PATCH = 1 << 0,
+  RUSTLERS_BATCH = 1 << 1,
+};
+
+struct BroadcastMessage {
+  BroadcastMessage(const char *data, const size_t length,
+                   const uint32_t required_capabilities = 0,
+                   const uint32_t excluded_capabilities = 0)
+      : data(data, length),
+        required_capabilities(required_capabilities),
+        excluded_capabilities(excluded_capabilities) {}
+
+  bool Accepts(const uint32_t capabilities) const {
+    return (capabilities & required_capabilities) == required_capabilities &&
+           (capabilities & excluded_capabilities) == 0;
+  }
+
+  const std::string data;
+  const uint32_t required_capabilities;
+  const uint32_t excluded_capabilities;
+
+  // permessage-deflate payload for clients that negotiated compression, left
+  // empty if compression is disabled or the message is too small to benefit
+  std::string deflated;
+};
+
+/**
+ * Messages produced by a single broadcast tick. If |streams_set| is set it
+ * holds the full STREAMS_SET message as of this broadcast and replaces the
+ * list sent to newly connected clients.
+ */
+struct Broadcast {
+  std::vector<BroadcastMessage> messages;
+  std::shared_ptr<const std::string> streams_set;
+};
+
+/**
+ * Single producer single consumer queue delivering broadcasts to one hub. If
+ * the hub falls far enough behind that the queue fills the broadcast is
+ * dropped and the hub is expected to resync its clients from the latest
+ * STREAMS_SET.
+ */
+class BroadcastQueue {
+ public:
+  explicit BroadcastQueue(const uint32_t size) : queue_(size) {}
+
+  void Write(std::shared_ptr<const Broadcast> broadcast) {
+    if (!queue_.write(std::move(broadcast))) {
+      overflow_ = true;
+    }
+  }
+
+  bool Read(std::shared_ptr<const Broadcast> *broadcast) {
+    return queue_.read(*broadcast);
+  }
+
+  bool TakeOverflow() { return overflow_.exchange(false); }
+
+ private:
+  folly::ProducerConsumerQueue<std::shared_ptr<const Broadcast>> queue_;
+  std::atomic<bool> overflow_{false};
+};
+
+/**
+ * Builds STREAMS_SET and RUSTLERS_SET payloads once per tick and publishes
+ * them to every subscribed hub. BroadcastStreams and BroadcastRustlers must be
+ * called from the same thread.
+ */
+class Broadcaster {
+ public:
+  explicit Broadcaster(std::shared_ptr<DB> db);
+
+  std::shared_ptr<BroadcastQueue> Subscribe();
+
+  std::shared_ptr<const std::string> GetStreamsSetJSON() {
+    return std::atomic_load(&streams_set_);
+  }
+
+  /**
+   * Return the GET /api response for the current streams and rustler counts,
+   * or nullptr until the first broadcast.
+   */
+  std::shared_ptr<const CachedHTTPResponse> GetAPIResponse() {
+    return std::atomic_load(&api_response_);
+  }
+
+  void BroadcastStreams();
+
+  void BroadcastRustlers();
+
+ private:
+  void AddMessage(Broadcast *broadcast, const char *data, const size_t length,
+                  const uint32_t required_capabilities = 0,
+                  const uint32_t excluded_capabilities = 0);
+
+  void Publish(std::shared_ptr<const Broadcast> broadcast);
+
+  void UpdateAPIResponse(const std::vector<std::shared_ptr<Stream>> &streams);
+
+  std::shared_ptr<DB> db_;
+  std::mutex subscribers_lock_;
+  std::vector<std::shared_ptr<BroadcastQueue>> subscribers_;
+  std::shared_ptr<const std::string> streams_set_;
+  std::shared_ptr<const CachedHTTPResponse> api_response_;
+  // distinguishes ETags from before a restart, when versions reset
+  const time_t start_time_;
+  // bumped whenever the /api response is rebuilt
+  uint64_t api_version_{0};
+  StreamsDelta streams_delta_;
+  rapidjson::StringBuffer buf_;
+  bool compression_;
+  Deflater deflater_;
+  uint64_t last_rustler_broadcast_time_{0};
+};
+
+}  // namespace rustla2
@@ -0,0 +1,60 @@
+#include "CachedHTTPResponse.h"
+
+#include "Compression.h"
+#include "HTTPResponseWriter.h"
+
+namespace rustla2 {
+
+CachedHTTPResponse::CachedHTTPResponse(const std::string& body,
+                                       const std::string& content_type,
+                                       const std::string& etag,
+                                       const time_t last_modified)
+    : etag_(etag) {
+  std::tm last_modified_tm;
+  gmtime_r(&last_modified, &last_modified_tm);
+
+  auto write_headers = [&](HTTPResponseWriter* writer) {
+    writer->Status(200, "OK");
+    writer->Header("Content-Type", content_type);
+    writer->Header("ETag", etag_);
+    writer->Header("Last-Modified", &last_modified_tm);
+    writer->Header("Vary", "Accept-Encoding");
+  };
+
+  HTTPResponseWriter identity_writer(&identity_);
+  write_headers(&identity_writer);
+  identity_writer.UncompressedBody(body.data(), body.size());
+
+  std::string compressed;
+  if (Compress(ContentEncoding::GZIP, body.data(), body.size(), &compressed,
+               Z_BEST_COMPRESSION) &&
+      compressed.size() < body.size()) {
+    HTTPResponseWriter gzip_writer(&gzip_);
+    write_headers(&gzip_writer);
+    gzip_writer.Header("Content-Encoding", "gzip");
+    gzip_writer.UncompressedBody(compressed.data(), compressed.size());
+  }
+
+  HTTPResponseWriter not_modified_writer(&not_modified_);
+  not_modified_writer.Status(304, "Not Modified");
+  not_modified_writer.Header("ETag", etag_);
+  not_modified_writer.Header("Last-Modified", &last_modified_tm);
+  not_modified_writer.Header("Vary", "Accept-Encoding");
+  not_modified_writer.EndHeaders();
+}
+
+void CachedHTTPResponse::Write(uWS::HttpResponse* res,
+                               HTTPRequest* req) const {
+  const std::string* response = &identity_;
+  if (req->MatchesIfNoneMatch(etag_)) {
+    response = &not_modified_;
+  } else if (!gzip_.empty() &&
+             req->GetAcceptedEncoding() == ContentEncoding::GZIP) {
+    response = &gzip_;
+  }
+
+  res->write(response->data(), response->size());
+  res->end();
+}
+
+}  // namespace rustla2
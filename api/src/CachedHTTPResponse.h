@@ -0,0 +1,33 @@
+#pragma once
+
+#include <uWS/uWS.h>
+#include <ctime>
+#include <string>
+
+#include "HTTPRequest.h"
+
+namespace rustla2 {
+
+/**
+ * Fully rendered 200 response with identity and gzip variants plus the 304
+ * sent to clients whose If-None-Match matches the ETag. Built once per
+ * version of the underlying data and shared read only between hub threads.
+ */
+class CachedHTTPResponse {
+ public:
+  CachedHTTPResponse(const std::string& body, const std::string& content_type,
+                     const std::string& etag, const time_t last_modified);
+
+  const std::string& GetETag() const { return etag_; }
+
+  void Write(uWS::HttpResponse* res, HTTPRequest* req) const;
+
+ private:
+  std::string etag_;
+  std::string identity_;
+  // left empty if compressing the body didn't make it smaller
+  std::string gzip_;
+  std::string not_modified_;
+};
+
+}  // namespace rustla2
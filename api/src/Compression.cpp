@@ -0,0 +1,243 @@
+#include "Compression.h"
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <glog/logging.h>
+#include <cstring>
+#include <vector>
+
+namespace rustla2 {
+
+namespace {
+
+// negative window bits produce raw deflate output without a zlib header
+const int kRawDeflateWindowBits = -15;
+const int kDeflateMemLevel = 8;
+
+// HTTP's deflate coding is the zlib format rather than raw deflate
+const int kZlibWindowBits = 15;
+
+// window bits above 15 wrap the deflate output in a gzip header and trailer
+const int kGzipWindowBits = 15 + 16;
+
+// every Z_SYNC_FLUSH ends with an empty stored block which permessage-deflate
+// requires senders to strip (RFC 7692 section 7.2.1)
+const char kDeflateTail[] = {'\x00', '\x00', '\xff', '\xff'};
+const size_t kDeflateTailSize = sizeof(kDeflateTail);
+
+// zlib stream for one HTTP content encoding owned by a single thread
+class HTTPDeflateStream {
+ public:
+  explicit HTTPDeflateStream(const int window_bits) {
+    std::memset(&stream_, 0, sizeof(stream_));
+    ok_ = deflateInit2(&stream_, level_, Z_DEFLATED, window_bits,
+                       kDeflateMemLevel, Z_DEFAULT_STRATEGY) == Z_OK;
+
+    if (!ok_) {
+      LOG(ERROR) << "HTTPDeflateStream failed to initialize zlib stream";
+    }
+  }
+
+  ~HTTPDeflateStream() {
+    if (ok_) {
+      deflateEnd(&stream_);
+    }
+  }
+
+  bool Compress(const char* data, const size_t length, std::string* output,
+                const int level) {
+    if (!ok_ || deflateReset(&stream_) != Z_OK) {
+      return false;
+    }
+
+    // parameters can be changed freely before the stream has seen any input
+    if (level != level_) {
+      if (deflateParams(&stream_, level, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+      }
+      level_ = level;
+    }
+
+    output->resize(deflateBound(&stream_, length));
+
+    stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream_.avail_in = length;
+    stream_.next_out = reinterpret_cast<Bytef*>(&(*output)[0]);
+    stream_.avail_out = output->size();
+
+    if (deflate(&stream_, Z_FINISH) != Z_STREAM_END) {
+      output->clear();
+      return false;
+    }
+
+    output->resize(output->size() - stream_.avail_out);
+    return true;
+  }
+
+ private:
+  z_stream stream_;
+  int level_{Z_DEFAULT_COMPRESSION};
+  bool ok_{false};
+};
+
+// q value of a single Accept-Encoding entry, defaulting to 1
+double GetQuality(folly::StringPiece params) {
+  std::vector<folly::StringPiece> parts;
+  folly::split(';', params, parts);
+  for (auto part : parts) {
+    part = folly::trimWhitespace(part);
+    if (part.removePrefix("q=")) {
+      return folly::tryTo<double>(part).value_or(0);
+    }
+  }
+  return 1;
+}
+
+}  // namespace
+
+Deflater::Deflater(const int level) {
+  std::memset(&stream_, 0, sizeof(stream_));
+  ok_ = deflateInit2(&stream_, level, Z_DEFLATED, kRawDeflateWindowBits,
+                     kDeflateMemLevel, Z_DEFAULT_STRATEGY) == Z_OK;
+
+  if (!ok_) {
+    LOG(ERROR) << "Deflater failed to initialize zlib stream";
+  }
+}
+
+Deflater::~Deflater() {
+  if (ok_) {
+    deflateEnd(&stream_);
+  }
+}
+
+/**
+ * Compress |data| as a single permessage-deflate message. The output buffer is
+ * sized up front from deflateBound so the message is almost always compressed
+ * in one pass.
+ */
+bool Deflater::Deflate(const char* data, const size_t length,
+                       std::string* output) {
+  if (!ok_ || deflateReset(&stream_) != Z_OK) {
+    return false;
+  }
+
+  output->resize(deflateBound(&stream_, length) + kDeflateTailSize);
+
+  stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream_.avail_in = length;
+  stream_.next_out = reinterpret_cast<Bytef*>(&(*output)[0]);
+  stream_.avail_out = output->size();
+
+  // zlib may still hold flush output when it fills the buffer. Calling it
+  // again once the flush is actually complete would add a second flush
+  // marker, so a full buffer is only grown if output is pending.
+  while (true) {
+    if (deflate(&stream_, Z_SYNC_FLUSH) != Z_OK) {
+      output->clear();
+      return false;
+    }
+    if (stream_.avail_out != 0) {
+      break;
+    }
+
+    unsigned pending = 0;
+    int bits = 0;
+    if (stream_.avail_in == 0 &&
+        deflatePending(&stream_, &pending, &bits) == Z_OK && pending == 0 &&
+        bits == 0) {
+      break;
+    }
+
+    const size_t written = output->size();
+    output->resize(written * 2);
+    stream_.next_out = reinterpret_cast<Bytef*>(&(*output)[written]);
+    stream_.avail_out = output->size() - written;
+  }
+
+  if (stream_.avail_in != 0) {
+    output->clear();
+    return false;
+  }
+
+  size_t size = output->size() - stream_.avail_out;
+  if (size >= kDeflateTailSize &&
+      std::memcmp(output->data() + size - kDeflateTailSize, kDeflateTail,
+                  kDeflateTailSize) == 0) {
+    size -= kDeflateTailSize;
+  }
+  output->resize(size);
+
+  return true;
+}
+
+ContentEncoding NegotiateContentEncoding(folly::StringPiece accept_encoding) {
+  double gzip = -1;
+  double deflate = -1;
+  double wildcard = -1;
+
+  std::vector<folly::StringPiece> entries;
+  folly::split(',', accept_encoding, entries);
+  for (auto entry : entries) {
+    const auto params_start = entry.find(';');
+    const auto coding = folly::trimWhitespace(entry.subpiece(0, params_start));
+    const auto params = params_start == folly::StringPiece::npos
+                            ? folly::StringPiece()
+                            : entry.subpiece(params_start + 1);
+
+    const auto quality = GetQuality(params);
+    if (coding == "gzip" || coding == "x-gzip") {
+      gzip = quality;
+    } else if (coding == "deflate") {
+      deflate = quality;
+    } else if (coding == "*") {
+      wildcard = quality;
+    }
+  }
+
+  // codings not listed explicitly inherit the wildcard's quality
+  if (gzip < 0) {
+    gzip = wildcard;
+  }
+  if (deflate < 0) {
+    deflate = wildcard;
+  }
+
+  if (gzip > 0 && gzip >= deflate) {
+    return ContentEncoding::GZIP;
+  }
+  if (deflate > 0) {
+    return ContentEncoding::DEFLATE;
+  }
+  return ContentEncoding::IDENTITY;
+}
+
+const char* GetContentEncodingName(const ContentEncoding encoding) {
+  switch (encoding) {
+    case ContentEncoding::GZIP:
+      return "gzip";
+    case ContentEncoding::DEFLATE:
+      return "deflate";
+    default:
+      return "identity";
+  }
+}
+
+bool Compress(const ContentEncoding encoding, const char* data,
+              const size_t length, std::string* output, const int level) {
+  switch (encoding) {
+    case ContentEncoding::GZIP: {
+      thread_local HTTPDeflateStream gzip(kGzipWindowBits);
+      return gzip.Compress(data, length, output, level);
+    }
+    case ContentEncoding::DEFLATE: {
+      thread_local HTTPDeflateStream deflate(kZlibWindowBits);
+      return deflate.Compress(data, length, output, level);
+    }
+    default:
+      output->assign(data, length);
+      return true;
+  }
+}
+
+}  // namespace rustla2
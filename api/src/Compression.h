@@ -0,0 +1,56 @@
+#pragma once
+
+#include <folly/Range.h>
+#include <zlib.h>
+#include <cstdlib>
+#include <string>
+
+namespace rustla2 {
+
+/**
+ * Raw deflate compressor for WebSocket permessage-deflate payloads. The
+ * stream is reset between messages, matching the server_no_context_takeover
+ * parameter negotiated by uWS, so each message can be compressed once and
+ * sent to any client that negotiated the extension.
+ */
+class Deflater {
+ public:
+  explicit Deflater(const int level = Z_DEFAULT_COMPRESSION);
+
+  ~Deflater();
+
+  Deflater(const Deflater&) = delete;
+
+  Deflater& operator=(const Deflater&) = delete;
+
+  bool Deflate(const char* data, const size_t length, std::string* output);
+
+ private:
+  z_stream stream_;
+  bool ok_{false};
+};
+
+enum class ContentEncoding {
+  IDENTITY,
+  GZIP,
+  DEFLATE,
+};
+
+/**
+ * Choose the response encoding from an Accept-Encoding header, preferring
+ * gzip over deflate and honoring q=0 exclusions.
+ */
+ContentEncoding NegotiateContentEncoding(folly::StringPiece accept_encoding);
+
+const char* GetContentEncodingName(const ContentEncoding encoding);
+
+/**
+ * Compress |data| as a complete HTTP response body in |encoding|. zlib state
+ * is kept per thread and reset between calls rather than allocated for every
+ * response.
+ */
+bool Compress(const ContentEncoding encoding, const char* data,
+              const size_t length, std::string* output,
+              const int level = Z_DEFAULT_COMPRESSION);
+
+}  // namespace rustla2
@@ -1,5 +1,6 @@
 #include "Config.h"
 
+#include <folly/String.h>
 #include <folly/Uri.h>
 #include <cstdlib>
 #include <cstring>
@@ -23,11 +24,26 @@ constexpr char kDefaultJWTName[] = "jwt";
 constexpr time_t kDefaultJWTTTL = 60 * 60 * 24 * 7;
 constexpr uint16_t kDefaultPort = 8080;
 constexpr time_t kDefaultLiveCheckInterval = 60000;
+constexpr time_t kDefaultLivecheckMaxInterval = 600000;
 constexpr char kDefaultIPAddressHeader[] = "x-client-ip";
 constexpr time_t kDefaultStreamBroadcastInterval = 60000;
 constexpr time_t kDefaultRustlerBroadcastInterval = 100;
+constexpr bool kDefaultWSCompression = false;
 constexpr char kDefaultPublicPath[] = "./public";
 constexpr time_t kDefaultBanCheckInterval = 60000;
+constexpr time_t kDefaultHTTPKeepAliveTimeout = 5000;
+constexpr uint32_t kDefaultHTTPKeepAliveMaxRequests = 100;
+constexpr time_t kDefaultDBWriteInterval = 250;
+constexpr char kDefaultDBJournalMode[] = "WAL";
+constexpr char kDefaultDBSynchronous[] = "NORMAL";
+constexpr uint64_t kDefaultDBMmapSize = 256 * 1024 * 1024;
+constexpr uint64_t kDefaultDBCacheSize = 16 * 1024;
+constexpr uint32_t kDefaultLivecheckConcurrency = 16;
+constexpr uint32_t kDefaultTwitchRateLimit = 20;
+constexpr uint32_t kDefaultYouTubeRateLimit = 10;
+constexpr uint32_t kDefaultAngelThumpRateLimit = 10;
+constexpr time_t kDefaultTwitchUserIDTTL = 60 * 60 * 24 * 7;
+constexpr time_t kDefaultTwitchUserIDNegativeTTL = 60 * 60;
 
 }  // namespace
 
@@ -58,11 +74,39 @@ void Config::Init(const std::string& config_path) {
              kDefaultStreamBroadcastInterval);
   AssignUint(&rustler_broadcast_interval, "RUSTLER_BROADCAST_INTERVAL", config,
              kDefaultRustlerBroadcastInterval);
+  AssignBool(&ws_compression_, "WS_COMPRESSION", config,
+             kDefaultWSCompression);
   AssignString(&ssl_cert_path_, "SSL_CERT_PATH", config);
   AssignString(&ssl_key_path_, "SSL_KEY_PATH", config);
   AssignString(&public_path_, "PUBLIC_PATH", config, kDefaultPublicPath);
   AssignUint(&ban_check_interval_, "BAN_CHECK_INTERVAL", config,
              kDefaultBanCheckInterval);
+  AssignUint(&http_keep_alive_timeout_, "HTTP_KEEP_ALIVE_TIMEOUT", config,
+             kDefaultHTTPKeepAliveTimeout);
+  AssignUint(&http_keep_alive_max_requests_, "HTTP_KEEP_ALIVE_MAX_REQUESTS",
+             config, kDefaultHTTPKeepAliveMaxRequests);
+  AssignUint(&db_write_interval_, "DB_WRITE_INTERVAL", config,
+             kDefaultDBWriteInterval);
+  AssignString(&db_journal_mode_, "DB_JOURNAL_MODE", config,
+               kDefaultDBJournalMode);
+  AssignString(&db_synchronous_, "DB_SYNCHRONOUS", config,
+               kDefaultDBSynchronous);
+  AssignUint(&db_mmap_size_, "DB_MMAP_SIZE", config, kDefaultDBMmapSize);
+  AssignUint(&db_cache_size_, "DB_CACHE_SIZE", config, kDefaultDBCacheSize);
+  AssignUint(&livecheck_concurrency_, "LIVECHECK_CONCURRENCY", config,
+             kDefaultLivecheckConcurrency);
+  AssignUint(&livecheck_max_interval_, "LIVECHECK_MAX_INTERVAL", config,
+             kDefaultLivecheckMaxInterval);
+  AssignUint(&twitch_rate_limit_, "TWITCH_RATE_LIMIT", config,
+             kDefaultTwitchRateLimit);
+  AssignUint(&youtube_rate_limit_, "YOUTUBE_RATE_LIMIT", config,
+             kDefaultYouTubeRateLimit);
+  AssignUint(&angelthump_rate_limit_, "ANGELTHUMP_RATE_LIMIT", config,
+             kDefaultAngelThumpRateLimit);
+  AssignUint(&twitch_user_id_ttl_, "TWITCH_USER_ID_TTL", config,
+             kDefaultTwitchUserIDTTL);
+  AssignUint(&twitch_user_id_negative_ttl_, "TWITCH_USER_ID_NEGATIVE_TTL",
+             config, kDefaultTwitchUserIDNegativeTTL);
 
   if (!ssl_cert_path_.empty() && !ssl_key_path_.empty() &&
       !AssignString(&ssl_key_password_, "SSL_KEY_PASSWORD", config)) {
@@ -117,4 +161,30 @@ bool Config::AssignString(
   return false;
 }
 
+bool Config::AssignBool(
+    bool* prop, const std::string& key,
+    const std::unordered_map<std::string, std::string>& config,
+    const bool fallback) {
+  *prop = fallback;
+
+  std::string value;
+  if (!AssignString(&value, key, config)) {
+    return false;
+  }
+
+  auto lower = value;
+  folly::toLowerAscii(lower);
+  if (lower == "true" || lower == "1") {
+    *prop = true;
+  } else if (lower == "false" || lower == "0") {
+    *prop = false;
+  } else {
+    std::cerr << "ignoring invalid " << key << " \"" << value
+              << "\", expected true or false" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
 }  // namespace rustla2
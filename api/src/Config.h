@@ -43,6 +43,7 @@ class Config {
 
   uint16_t GetPort() { return port_; }
 
+  // shortest time between checks of a stream, used after it changes
   time_t GetLivecheckInterval() { return livecheck_interval_; }
 
   const std::string& GetTwitchClientID() { return twitch_client_id_; }
@@ -59,6 +60,8 @@ class Config {
 
   time_t GetRustlerBroadcastInterval() { return rustler_broadcast_interval; }
 
+  bool GetWSCompression() { return ws_compression_; }
+
   const std::string& GetSSLCertPath() { return ssl_cert_path_; }
 
   const std::string& GetSSLKeyPath() { return ssl_key_path_; }
@@ -69,6 +72,42 @@ class Config {
 
   const time_t GetBanCheckInterval() { return ban_check_interval_; }
 
+  time_t GetHTTPKeepAliveTimeout() { return http_keep_alive_timeout_; }
+
+  uint32_t GetHTTPKeepAliveMaxRequests() {
+    return http_keep_alive_max_requests_;
+  }
+
+  time_t GetDBWriteInterval() { return db_write_interval_; }
+
+  const std::string& GetDBJournalMode() { return db_journal_mode_; }
+
+  const std::string& GetDBSynchronous() { return db_synchronous_; }
+
+  // bytes of the database file to memory map, 0 to disable
+  uint64_t GetDBMmapSize() { return db_mmap_size_; }
+
+  // page cache size per connection in KiB
+  uint64_t GetDBCacheSize() { return db_cache_size_; }
+
+  // streams checked in parallel by the ServicePoller
+  uint32_t GetLivecheckConcurrency() { return livecheck_concurrency_; }
+
+  // longest time unchanged streams are backed off to between checks
+  time_t GetLivecheckMaxInterval() { return livecheck_max_interval_; }
+
+  // requests per second made to each service's API, 0 for no limit
+  uint32_t GetTwitchRateLimit() { return twitch_rate_limit_; }
+
+  uint32_t GetYouTubeRateLimit() { return youtube_rate_limit_; }
+
+  uint32_t GetAngelThumpRateLimit() { return angelthump_rate_limit_; }
+
+  // seconds a resolved Twitch login, or one found not to exist, is trusted
+  time_t GetTwitchUserIDTTL() { return twitch_user_id_ttl_; }
+
+  time_t GetTwitchUserIDNegativeTTL() { return twitch_user_id_negative_ttl_; }
+
  private:
   const std::unordered_map<std::string, std::string> ReadConfigFile(
       const std::string& path);
@@ -95,6 +134,11 @@ class Config {
     return false;
   }
 
+  // Accepts true/false or 1/0, falling back to |fallback| for anything else.
+  bool AssignBool(bool* prop, const std::string& key,
+                  const std::unordered_map<std::string, std::string>& config,
+                  const bool fallback);
+
   std::string api_;
   std::string api_ws_;
   std::string db_db_;
@@ -116,11 +160,26 @@ class Config {
   std::string ip_address_header_;
   time_t stream_broadcast_interval;
   time_t rustler_broadcast_interval;
+  bool ws_compression_;
   std::string ssl_cert_path_;
   std::string ssl_key_path_;
   std::string ssl_key_password_;
   std::string public_path_;
   time_t ban_check_interval_;
+  time_t http_keep_alive_timeout_;
+  uint32_t http_keep_alive_max_requests_;
+  time_t db_write_interval_;
+  std::string db_journal_mode_;
+  std::string db_synchronous_;
+  uint64_t db_mmap_size_;
+  uint64_t db_cache_size_;
+  uint32_t livecheck_concurrency_;
+  time_t livecheck_max_interval_;
+  uint32_t twitch_rate_limit_;
+  uint32_t youtube_rate_limit_;
+  uint32_t angelthump_rate_limit_;
+  time_t twitch_user_id_ttl_;
+  time_t twitch_user_id_negative_ttl_;
 };
 
 }  // namespace rustla2
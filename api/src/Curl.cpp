@@ -1,29 +1,131 @@
 #include "Curl.h"
 
+#include <algorithm>
 #include <cstring>
 
 namespace rustla2 {
 
-CurlRequest::CurlRequest(const std::string &url) : headers_(nullptr) {
-  curl_ = curl_easy_init();
+namespace {
+
+// idle handles kept per host, enough for every livecheck thread by default
+constexpr size_t kMaxIdleHandlesPerHost = 16;
+
+// largest Content-Length trusted to size the response buffer up front
+constexpr curl_off_t kMaxResponseSizeHint = 4 * 1024 * 1024;
+
+// Scheme, host and port of |url|, the part connections are reused for.
+std::string GetOrigin(const std::string &url) {
+  auto start = url.find("://");
+  start = start == std::string::npos ? 0 : start + 3;
+  return url.substr(0, url.find('/', start));
+}
+
+}  // namespace
+
+CurlPool &CurlPool::Get() {
+  static CurlPool pool;
+  return pool;
+}
+
+CurlPool::CurlPool() : share_(curl_share_init()) {
+  if (share_ == nullptr) {
+    return;
+  }
+
+  curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, CurlPool::Lock);
+  curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, CurlPool::Unlock);
+  curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+CurlPool::~CurlPool() {
+  for (const auto &i : idle_) {
+    for (const auto curl : i.second) {
+      curl_easy_cleanup(curl);
+    }
+  }
+  if (share_ != nullptr) {
+    curl_share_cleanup(share_);
+  }
+}
+
+CURL *CurlPool::Acquire(const std::string &url) {
+  {
+    std::lock_guard<std::mutex> lock(idle_lock_);
+    auto &idle = idle_[GetOrigin(url)];
+    if (!idle.empty()) {
+      auto curl = idle.back();
+      idle.pop_back();
+      return curl;
+    }
+  }
+
+  auto curl = curl_easy_init();
+  if (curl != nullptr) {
+    ++handles_;
+  }
+  return curl;
+}
+
+void CurlPool::Release(const std::string &url, CURL *curl) {
+  // clears options but keeps the handle's connections
+  curl_easy_reset(curl);
+
+  {
+    std::lock_guard<std::mutex> lock(idle_lock_);
+    auto &idle = idle_[GetOrigin(url)];
+    if (idle.size() < kMaxIdleHandlesPerHost) {
+      idle.push_back(curl);
+      return;
+    }
+  }
+
+  curl_easy_cleanup(curl);
+  --handles_;
+}
+
+void CurlPool::RecordTransfer(const long connects) {
+  ++transfers_;
+  if (connects > 0) {
+    connects_ += connects;
+  } else {
+    ++reused_;
+  }
+}
+
+void CurlPool::Lock(CURL *curl, curl_lock_data data, curl_lock_access access,
+                    void *pool) {
+  static_cast<CurlPool *>(pool)->share_locks_[data].lock();
+}
+
+void CurlPool::Unlock(CURL *curl, curl_lock_data data, void *pool) {
+  static_cast<CurlPool *>(pool)->share_locks_[data].unlock();
+}
+
+CurlRequest::CurlRequest(const std::string &url)
+    : url_(url), headers_(nullptr) {
+  curl_ = CurlPool::Get().Acquire(url_);
   if (curl_ == nullptr) {
     error_code_ = CURLE_FAILED_INIT;
     return;
   }
   error_code_ = CURLE_OK;
 
-  curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl_, CURLOPT_URL, url_.c_str());
+  curl_easy_setopt(curl_, CURLOPT_SHARE, CurlPool::Get().GetShare());
+  curl_easy_setopt(curl_, CURLOPT_TCP_KEEPALIVE, 1L);
   curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1);
   curl_easy_setopt(curl_, CURLOPT_CONNECTTIMEOUT, 3);
   curl_easy_setopt(curl_, CURLOPT_TIMEOUT, 3);
   curl_easy_setopt(curl_, CURLOPT_ACCEPT_ENCODING, "");
   curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, CurlRequest::WriteCallback);
-  curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &response_data_);
+  curl_easy_setopt(curl_, CURLOPT_WRITEDATA, this);
 }
 
 CurlRequest::~CurlRequest() {
   if (curl_) {
-    curl_easy_cleanup(curl_);
+    CurlPool::Get().Release(url_, curl_);
   }
 }
 
@@ -49,6 +151,13 @@ bool CurlRequest::Submit() {
   curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers_);
   error_code_ = curl_easy_perform(curl_);
   curl_slist_free_all(headers_);
+  headers_ = nullptr;
+
+  if (Ok()) {
+    long connects = 0;
+    curl_easy_getinfo(curl_, CURLINFO_NUM_CONNECTS, &connects);
+    CurlPool::Get().RecordTransfer(connects);
+  }
 
   return Ok();
 }
@@ -62,8 +171,6 @@ std::string CurlRequest::GetErrorMessage() const {
   return std::string(message, strlen(message));
 }
 
-std::string CurlRequest::GetResponse() const { return response_data_.str(); }
-
 int64_t CurlRequest::GetResponseCode() const {
   int64_t code;
   curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &code);
@@ -72,8 +179,20 @@ int64_t CurlRequest::GetResponseCode() const {
 
 size_t CurlRequest::WriteCallback(char *src, size_t size, size_t nmemb,
                                   void *dst) {
-  auto *data = (std::stringstream *)dst;
-  data->write(src, size * nmemb);
+  auto *req = static_cast<CurlRequest *>(dst);
+
+  // Headers are in by the first write, so the whole body can usually be
+  // allocated at once. Compressed responses report their compressed size
+  // and grow from there.
+  if (req->response_.empty()) {
+    curl_off_t length = -1;
+    curl_easy_getinfo(req->curl_, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+    if (length > 0) {
+      req->response_.reserve(std::min(length, kMaxResponseSizeHint));
+    }
+  }
+
+  req->response_.append(src, size * nmemb);
   return size * nmemb;
 }
 
@@ -1,12 +1,77 @@
 #pragma once
 
 #include <curl/curl.h>
+#include <atomic>
 #include <cstdlib>
-#include <sstream>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace rustla2 {
 
+/**
+ * Process wide libcurl state shared by every CurlRequest. Easy handles are
+ * kept after use in a pool per host and each keeps its own connection cache,
+ * so a later request to the same host usually finds a live connection and
+ * skips DNS, TCP and TLS setup. New handles still share DNS results and TLS
+ * sessions through one share handle. libcurl doesn't support sharing
+ * connections between threads, so the connections themselves aren't shared.
+ * Requests are made one per handle with curl_easy_perform, so there's nothing
+ * for HTTP/2 to multiplex and they stay on HTTP/1.1.
+ */
+class CurlPool {
+ public:
+  static CurlPool &Get();
+
+  CurlPool(const CurlPool &) = delete;
+
+  CurlPool &operator=(const CurlPool &) = delete;
+
+  /**
+   * Take an idle handle for the host of |url| or create one. Returns nullptr
+   * if libcurl can't create a handle.
+   */
+  CURL *Acquire(const std::string &url);
+
+  // Give a handle back once its transfer is done.
+  void Release(const std::string &url, CURL *curl);
+
+  CURLSH *GetShare() { return share_; }
+
+  // Called after each transfer with the connections it had to open.
+  void RecordTransfer(const long connects);
+
+  // Totals since startup. Transfers that opened no connection reused one and
+  // avoided a TCP and TLS handshake.
+  uint64_t GetTransferCount() const { return transfers_; }
+
+  uint64_t GetConnectCount() const { return connects_; }
+
+  uint64_t GetReusedCount() const { return reused_; }
+
+  uint64_t GetHandleCount() const { return handles_; }
+
+ private:
+  CurlPool();
+
+  ~CurlPool();
+
+  static void Lock(CURL *curl, curl_lock_data data, curl_lock_access access,
+                   void *pool);
+
+  static void Unlock(CURL *curl, curl_lock_data data, void *pool);
+
+  CURLSH *share_;
+  std::mutex share_locks_[CURL_LOCK_DATA_LAST];
+  std::mutex idle_lock_;
+  std::unordered_map<std::string, std::vector<CURL *>> idle_;
+  std::atomic<uint64_t> transfers_{0};
+  std::atomic<uint64_t> connects_{0};
+  std::atomic<uint64_t> reused_{0};
+  std::atomic<uint64_t> handles_{0};
+};
+
 class CurlRequest {
  public:
   explicit CurlRequest(const std::string &url);
@@ -29,16 +94,24 @@ class CurlRequest {
 
   std::string GetErrorMessage() const;
 
-  std::string GetResponse() const;
+  const std::string &GetResponse() const { return response_; }
+
+  // Move the response out, leaving the request's empty.
+  std::string TakeResponse() {
+    std::string response;
+    response.swap(response_);
+    return response;
+  }
 
   int64_t GetResponseCode() const;
 
   static size_t WriteCallback(char *src, size_t size, size_t nmemb, void *dst);
 
  private:
+  const std::string url_;
   CURL *curl_;
   curl_slist *headers_;
-  std::stringstream response_data_;
+  std::string response_;
   CURLcode error_code_;
 };
 
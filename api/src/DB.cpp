@@ -0,0 +1,67 @@
+#include "DB.h"
+
+#include <folly/Format.h>
+#include <glog/logging.h>
+#include <sqlite3.h>
+
+namespace rustla2 {
+
+namespace {
+
+// how long a connection retries while another holds a conflicting lock, e.g.
+// during a WAL checkpoint
+const int kBusyTimeout = 5000;
+
+}  // namespace
+
+DB::DB()
+    : db_(OpenConnection(false)),
+      reader_(OpenConnection(true)),
+      statements_(std::make_shared<PreparedStatements>(db_)),
+      writer_(std::make_shared<DBWriter>(
+          db_, std::chrono::milliseconds(Config::Get().GetDBWriteInterval()))),
+      users_(std::make_shared<Users>(db_, reader_, statements_, writer_)),
+      banned_ips_(std::make_shared<IPRanges>(db_, reader_, statements_,
+                                             writer_, "banned_ip_ranges")),
+      streams_(std::make_shared<Streams>(db_, reader_, statements_, writer_)),
+      user_bans_(std::make_shared<UserBans>(db_, reader_, statements_, writer_,
+                                           "user_bans", users_)),
+      stream_bans_(std::make_shared<StreamBans>(
+          db_, reader_, statements_, writer_, "stream_bans", streams_)),
+      ip_bans_(std::make_shared<IPBans>(db_, reader_, statements_, writer_,
+                                        "ip_bans", banned_ips_)),
+      twitch_user_ids_(std::make_shared<TwitchUserIDs>(db_, reader_,
+                                                       statements_, writer_)) {
+}
+
+sqlite::database DB::OpenConnection(const bool read_only) {
+  sqlite::database db(Config::Get().GetDBPath());
+  sqlite3_busy_timeout(db.connection().get(), kBusyTimeout);
+
+  if (!read_only) {
+    // the journal mode is stored in the database file so only the writer
+    // needs to set it, and it has to before any reader opens
+    db << folly::sformat("PRAGMA journal_mode = {};",
+                         Config::Get().GetDBJournalMode()) >>
+        [&](const std::string& journal_mode) {
+          LOG(INFO) << "sqlite journal mode " << journal_mode;
+        };
+  }
+
+  db << folly::sformat("PRAGMA synchronous = {};",
+                       Config::Get().GetDBSynchronous());
+  db << folly::sformat("PRAGMA mmap_size = {};",
+                       Config::Get().GetDBMmapSize()) >>
+      [](const int64_t mmap_size) {};
+  // negative sizes are in KiB rather than pages
+  db << folly::sformat("PRAGMA cache_size = -{};",
+                       Config::Get().GetDBCacheSize());
+
+  if (read_only) {
+    db << "PRAGMA query_only = 1;";
+  }
+
+  return db;
+}
+
+}  // namespace rustla2
@@ -1,31 +1,34 @@
 #pragma once
 
 #include <sqlite_modern_cpp.h>
+#include <chrono>
 #include <memory>
+#include <string>
 
 #include "Bans.h"
 #include "Config.h"
+#include "DBWriter.h"
 #include "IPRanges.h"
+#include "PreparedStatements.h"
 #include "Streams.h"
+#include "TwitchUserIDs.h"
 #include "Users.h"
 
 namespace rustla2 {
 
+/**
+ * Owns the database connections and the collections loaded from them. All
+ * writes go through a single writer connection. The collections are loaded
+ * through a separate read only connection which, with WAL journaling, never
+ * waits on it; after that they're served from memory.
+ */
 class DB {
   using UserBans = Bans<Users>;
   using StreamBans = Bans<Streams>;
   using IPBans = Bans<IPRanges, IPRangeBanMediator>;
 
  public:
-  DB()
-      : db_(Config::Get().GetDBPath()),
-        users_(std::make_shared<Users>(db_)),
-        streams_(std::make_shared<Streams>(db_)),
-        banned_ips_(std::make_shared<IPRanges>(db_, "banned_ip_ranges")),
-        user_bans_(std::make_shared<UserBans>(db_, "user_bans", users_)),
-        stream_bans_(
-            std::make_shared<StreamBans>(db_, "stream_bans", streams_)),
-        ip_bans_(std::make_shared<IPBans>(db_, "ip_bans", banned_ips_)) {}
+  DB();
 
   std::shared_ptr<Users> GetUsers() { return users_; }
 
@@ -39,14 +42,28 @@ class DB {
 
   std::shared_ptr<IPBans> GetIPBans() { return ip_bans_; }
 
+  std::shared_ptr<DBWriter> GetWriter() { return writer_; }
+
+  std::shared_ptr<TwitchUserIDs> GetTwitchUserIDs() {
+    return twitch_user_ids_;
+  }
+
  private:
+  static sqlite::database OpenConnection(const bool read_only);
+
   sqlite::database db_;
+  sqlite::database reader_;
+  // shared by every collection so each statement is compiled once for the
+  // writer connection
+  std::shared_ptr<PreparedStatements> statements_;
+  std::shared_ptr<DBWriter> writer_;
   std::shared_ptr<Users> users_;
   std::shared_ptr<IPRanges> banned_ips_;
   std::shared_ptr<Streams> streams_;
   std::shared_ptr<UserBans> user_bans_;
   std::shared_ptr<StreamBans> stream_bans_;
   std::shared_ptr<IPBans> ip_bans_;
+  std::shared_ptr<TwitchUserIDs> twitch_user_ids_;
 };
 
 }  // namespace rustla2
@@ -0,0 +1,171 @@
+#include "DBWriter.h"
+
+#include <glog/logging.h>
+#include <utility>
+
+namespace rustla2 {
+
+constexpr uint32_t DBWriter::kMaxAttempts;
+
+DBWriter::DBWriter(sqlite::database db,
+                   const std::chrono::milliseconds interval)
+    : db_(db), interval_(interval), thread_([this]() { Run(); }) {}
+
+DBWriter::~DBWriter() {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    stopping_ = true;
+  }
+  stopped_.notify_one();
+  thread_.join();
+
+  Flush();
+}
+
+void DBWriter::Enqueue(const void* key, Write write, const bool is_insert,
+                       Rollback rollback) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = pending_.find(key);
+  if (it == pending_.end()) {
+    order_.push_back(key);
+    pending_.emplace(key, PendingWrite{std::move(write), is_insert,
+                                       std::move(rollback)});
+  } else if (!it->second.is_insert) {
+    it->second =
+        PendingWrite{std::move(write), is_insert, std::move(rollback)};
+  }
+}
+
+void DBWriter::Flush() {
+  // one flush at a time so batches commit in the order they were queued
+  std::lock_guard<std::mutex> flush_lock(flush_lock_);
+  FlushLocked(nullptr);
+}
+
+bool DBWriter::WriteNow(const void* key, Write write) {
+  std::lock_guard<std::mutex> flush_lock(flush_lock_);
+  Enqueue(key, std::move(write));
+  return FlushLocked(key);
+}
+
+bool DBWriter::FlushLocked(const void* key) {
+  std::vector<const void*> order;
+  std::unordered_map<const void*, PendingWrite> pending;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    order.swap(order_);
+    pending.swap(pending_);
+  }
+  if (order.empty()) {
+    return false;
+  }
+
+  // writes are never run outside a transaction, where each would commit on
+  // its own and a failure partway would leave the batch half written
+  try {
+    db_ << "BEGIN;";
+  } catch (const sqlite::sqlite_exception& e) {
+    LOG(ERROR) << "DBWriter failed to begin transaction, "
+               << "error: " << e.what() << ", "
+               << "code: " << e.get_extended_code();
+    Requeue(order, &pending);
+    return false;
+  }
+
+  // failed writes are logged by the models and dropped rather than retried
+  // forever, the same as when they were written inline
+  size_t failed = 0;
+  bool key_written = false;
+  for (const auto k : order) {
+    const bool written = pending[k].write();
+    if (!written) {
+      ++failed;
+    }
+    if (k == key) {
+      key_written = written;
+    }
+  }
+
+  try {
+    db_ << "COMMIT;";
+  } catch (const sqlite::sqlite_exception& e) {
+    LOG(ERROR) << "DBWriter failed to commit " << order.size() << " writes, "
+               << "error: " << e.what() << ", "
+               << "code: " << e.get_extended_code();
+
+    // otherwise the connection stays in the transaction and every later
+    // batch fails to begin
+    try {
+      db_ << "ROLLBACK;";
+    } catch (const sqlite::sqlite_exception& rollback_error) {
+      // sqlite may already have rolled back, which is fine
+      DLOG(INFO) << "DBWriter rollback failed, "
+                 << "error: " << rollback_error.what();
+    }
+
+    for (const auto k : order) {
+      if (pending[k].rollback) {
+        pending[k].rollback();
+      }
+    }
+
+    Requeue(order, &pending);
+    return false;
+  }
+
+  DLOG(INFO) << "DBWriter committed " << order.size() - failed << " writes, "
+             << failed << " failed";
+  return key_written;
+}
+
+void DBWriter::Requeue(const std::vector<const void*>& order,
+                       std::unordered_map<const void*, PendingWrite>* pending) {
+  std::lock_guard<std::mutex> lock(lock_);
+
+  std::vector<const void*> requeued;
+  std::unordered_set<const void*> requeued_keys;
+  size_t dropped = 0;
+  for (const auto key : order) {
+    auto& write = (*pending)[key];
+    if (++write.attempts >= kMaxAttempts) {
+      ++dropped;
+      continue;
+    }
+
+    // an update queued since is kept unless this was the model's insert,
+    // which was rolled back and writes the current state anyway
+    auto it = pending_.find(key);
+    if (it == pending_.end()) {
+      pending_.emplace(key, std::move(write));
+    } else if (write.is_insert) {
+      it->second = std::move(write);
+    }
+    requeued.push_back(key);
+    requeued_keys.insert(key);
+  }
+
+  for (const auto key : order_) {
+    if (requeued_keys.count(key) == 0) {
+      requeued.push_back(key);
+    }
+  }
+  order_.swap(requeued);
+
+  if (dropped > 0) {
+    LOG(ERROR) << "DBWriter dropped " << dropped << " writes after "
+               << kMaxAttempts << " failed transactions";
+  }
+}
+
+void DBWriter::Run() {
+  std::unique_lock<std::mutex> lock(lock_);
+  while (!stopping_) {
+    stopped_.wait_for(lock, interval_, [this]() { return stopping_; });
+
+    lock.unlock();
+    Flush();
+    lock.lock();
+  }
+}
+
+}  // namespace rustla2
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <sqlite_modern_cpp.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace rustla2 {
+
+/**
+ * Write-behind queue for model saves. Writes are queued by the threads that
+ * change models and run on a dedicated thread, batched into one transaction
+ * every |interval|, so request handlers never wait on disk.
+ *
+ * Writes read the model's state when they run rather than when they're
+ * queued, so repeated saves of a model between flushes coalesce into one.
+ *
+ * A batch whose transaction fails to begin or commit is rolled back and
+ * queued again ahead of newer writes. Writes in a batch that fails
+ * kMaxAttempts times are logged and dropped. Models that track what they've
+ * written pass a rollback callback to restore that state when the
+ * transaction they ran in is rolled back.
+ */
+class DBWriter {
+ public:
+  using Write = std::function<bool()>;
+
+  using Rollback = std::function<void()>;
+
+  static constexpr uint32_t kMaxAttempts = 3;
+
+  DBWriter(sqlite::database db, const std::chrono::milliseconds interval);
+
+  // Writes anything still queued before returning.
+  ~DBWriter();
+
+  DBWriter(const DBWriter&) = delete;
+
+  DBWriter& operator=(const DBWriter&) = delete;
+
+  /**
+   * Queue |write| for the model identified by |key|. The write must keep the
+   * model alive until it runs. An insert already queued for the model is
+   * kept since it will write the current state anyway. |rollback|, if set, is
+   * called if |write| ran but its transaction didn't commit.
+   */
+  void Enqueue(const void* key, Write write, const bool is_insert = false,
+               Rollback rollback = nullptr);
+
+  // Run every queued write now.
+  void Flush();
+
+  /**
+   * Queue |write| for the model identified by |key| and flush now. Returns
+   * true only if the model's write succeeded and was committed, for callers
+   * that have to report whether a change was saved.
+   */
+  bool WriteNow(const void* key, Write write);
+
+  /**
+   * Hold the connection between batches. Statements run on it outside the
+   * DBWriter commit on their own, and must hold this so they never land in
+   * the middle of a batch's transaction and get rolled back with it.
+   */
+  std::unique_lock<std::mutex> LockConnection() {
+    return std::unique_lock<std::mutex>(flush_lock_);
+  }
+
+ private:
+  struct PendingWrite {
+    Write write;
+    bool is_insert;
+    Rollback rollback;
+    // failed transactions this write has been part of
+    uint32_t attempts{0};
+  };
+
+  // Run every queued write with |flush_lock_| held. Returns whether the write
+  // queued for |key| succeeded and was committed.
+  bool FlushLocked(const void* key);
+
+  // Queue a batch that failed to commit again, ahead of newer writes.
+  void Requeue(const std::vector<const void*>& order,
+               std::unordered_map<const void*, PendingWrite>* pending);
+
+  void Run();
+
+  sqlite::database db_;
+  const std::chrono::milliseconds interval_;
+  // held for each batch's whole transaction
+  std::mutex flush_lock_;
+  std::mutex lock_;
+  std::condition_variable stopped_;
+  bool stopping_{false};
+  // keys in the order they were first queued so rows are inserted before
+  // rows that reference them
+  std::vector<const void*> order_;
+  std::unordered_map<const void*, PendingWrite> pending_;
+  std::thread thread_;
+};
+
+}  // namespace rustla2
@@ -9,24 +9,45 @@ namespace rustla2 {
 
 namespace {
 const boost::regex query_regex("(?:^|&)([^=]+)=([^&]+)");
+
+// The Connection header is a comma separated list of tokens and any of them
+// may be `close`. uWS drops the HTTP version from the request line, so
+// HTTP/1.0 clients are treated as persistent too unless they send `close`;
+// the idle timeout in HTTPService bounds how long they're held open.
+bool ParseKeepAlive(folly::StringPiece connection) {
+  std::vector<folly::StringPiece> tokens;
+  folly::split(',', connection, tokens);
+  for (const auto token : tokens) {
+    if (folly::caseInsensitiveEqual(folly::trimWhitespace(token), "close")) {
+      return false;
+    }
+  }
+  return true;
 }
+}  // namespace
 
-HTTPRequest::HTTPRequest(uWS::HttpRequest req) : req_(req) {
+HTTPRequest::HTTPRequest(uWS::HttpRequest req)
+    : req_(req),
+      response_options_{
+          NegotiateContentEncoding(GetHeader("accept-encoding")),
+          ParseKeepAlive(GetHeader("connection"))} {
   const auto& url = req.getUrl();
   folly::StringPiece uri(url.value, url.valueLength);
-  folly::StringPiece path, query;
-  if (folly::split('?', uri, path, query)) {
-    folly::split('/', path, path_);
-    query_ = query;
+  const auto query_start = uri.find('?');
+  if (query_start == folly::StringPiece::npos) {
+    path_string_ = uri;
   } else {
-    folly::split('/', uri, path_);
+    path_string_ = uri.subpiece(0, query_start);
+    query_ = uri.subpiece(query_start + 1);
   }
 }
 
 HTTPRequest::HTTPRequest(rustla2::HTTPRequest&& req) noexcept
     : req_(std::move(req.req_)),
+      path_string_(req.path_string_),
       path_(std::move(req.path_)),
       query_(std::move(req.query_)),
+      response_options_(req.response_options_),
       post_data_(std::move(req.post_data_)),
       post_data_handler_(std::move(req.post_data_handler_)) {}
 
@@ -79,4 +100,29 @@ folly::StringPiece HTTPRequest::GetClientIPHeader() {
   return folly::StringPiece(header.value, header.valueLength);
 }
 
+folly::StringPiece HTTPRequest::GetHeader(const char* name) {
+  auto header = req_.getHeader(name);
+  return folly::StringPiece(header.value, header.valueLength);
+}
+
+bool HTTPRequest::MatchesIfNoneMatch(folly::StringPiece etag) {
+  const auto if_none_match = GetHeader("if-none-match");
+  if (if_none_match.empty()) {
+    return false;
+  }
+
+  std::vector<folly::StringPiece> tags;
+  folly::split(',', if_none_match, tags);
+  for (auto tag : tags) {
+    tag = folly::trimWhitespace(tag);
+    // weak comparison (RFC 7232 section 3.2)
+    tag.removePrefix("W/");
+    if (tag == "*" || tag == etag) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 }  // namespace rustla2
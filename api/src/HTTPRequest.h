@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "Config.h"
+#include "HTTPResponseWriter.h"
 #include "Session.h"
 
 namespace rustla2 {
@@ -33,14 +34,47 @@ class HTTPRequest {
 
   folly::StringPiece GetClientIPHeader();
 
-  const std::vector<folly::StringPiece>& GetPath() const { return path_; }
+  folly::StringPiece GetHeader(const char* name);
 
-  folly::StringPiece GetPathPart(size_t i) const { return path_[i]; }
+  // True if the If-None-Match header lists |etag| or `*`.
+  bool MatchesIfNoneMatch(folly::StringPiece etag);
+
+  // Response encoding negotiated from Accept-Encoding and whether the
+  // connection stays open. Resolved up front so handlers that respond after
+  // the request headers are gone can use them.
+  const HTTPResponseOptions& GetResponseOptions() const {
+    return response_options_;
+  }
+
+  ContentEncoding GetAcceptedEncoding() const {
+    return response_options_.encoding;
+  }
+
+  bool GetKeepAlive() const { return response_options_.keep_alive; }
+
+  void SetKeepAlive(const bool keep_alive) {
+    response_options_.keep_alive = keep_alive;
+  }
+
+  folly::StringPiece GetPathString() const { return path_string_; }
+
+  // Path segments are split on first use since most requests are routed by
+  // their full path and never need them.
+  const std::vector<folly::StringPiece>& GetPath() const {
+    if (path_.empty()) {
+      folly::split('/', path_string_, path_);
+    }
+    return path_;
+  }
+
+  folly::StringPiece GetPathPart(size_t i) const { return GetPath()[i]; }
 
  private:
   uWS::HttpRequest req_;
-  std::vector<folly::StringPiece> path_;
+  folly::StringPiece path_string_;
+  mutable std::vector<folly::StringPiece> path_;
   folly::StringPiece query_;
+  HTTPResponseOptions response_options_;
   std::string post_data_;
   PostDataHandler post_data_handler_;
 };
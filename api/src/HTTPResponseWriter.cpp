@@ -1,67 +1,148 @@
 #include "HTTPResponseWriter.h"
 
-#include <folly/String.h>
-#include <boost/filesystem.hpp>
-#include <boost/iostreams/copy.hpp>
-#include <boost/iostreams/device/array.hpp>
-#include <boost/iostreams/device/back_inserter.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
-#include <boost/iostreams/filtering_streambuf.hpp>
-#include <fstream>
-#include <locale>
-#include <vector>
+#include <folly/Conv.h>
 
 #include "Config.h"
-#include "MIMETypes.h"
 #include "Session.h"
 
 namespace rustla2 {
 
-const size_t kResponseGzipMinSize = 300;
+namespace {
 
-namespace io = boost::iostreams;
+// bodies smaller than this rarely shrink enough to be worth compressing
+const size_t kResponseCompressionMinSize = 300;
 
-void HTTPResponseWriter::Status(const uint32_t code, const std::string& label) {
-  res_ << "HTTP/1.1 " << code << " " << label << "\r\n"
-       << "Connection: close\r\n";
+// per-thread buffers are released after unusually large responses rather
+// than holding onto the memory indefinitely
+const size_t kMaxRetainedBufferSize = 1 << 20;
+
+const char* const kDayNames[] = {"Sun", "Mon", "Tue", "Wed",
+                                 "Thu", "Fri", "Sat"};
+const char* const kMonthNames[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                   "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+thread_local std::string thread_buf;
+thread_local bool thread_buf_in_use = false;
+
+void AppendTwoDigits(const int value, std::string* buf) {
+  buf->push_back('0' + value / 10 % 10);
+  buf->push_back('0' + value % 10);
+}
+
+}  // namespace
+
+HTTPResponseWriter::HTTPResponseWriter(std::string* buf,
+                                       const HTTPResponseOptions& options,
+                                       const int compression_level)
+    : res_(nullptr),
+      buf_(buf),
+      options_(options),
+      compression_level_(compression_level) {}
+
+HTTPResponseWriter::HTTPResponseWriter(uWS::HttpResponse* res,
+                                       const HTTPResponseOptions& options,
+                                       const int compression_level)
+    : res_(res),
+      buf_(&local_buf_),
+      options_(options),
+      compression_level_(compression_level) {
+  if (!thread_buf_in_use) {
+    thread_buf_in_use = true;
+    owns_thread_buf_ = true;
+    buf_ = &thread_buf;
+    buf_->clear();
+  }
+}
+
+HTTPResponseWriter::~HTTPResponseWriter() {
+  if (res_ != nullptr) {
+    if (!buf_->empty()) {
+      res_->write(buf_->data(), buf_->size());
+    }
+    res_->end();
+  }
+
+  if (owns_thread_buf_) {
+    if (buf_->capacity() > kMaxRetainedBufferSize) {
+      std::string().swap(*buf_);
+    }
+    thread_buf_in_use = false;
+  }
+}
+
+void HTTPResponseWriter::Status(const uint32_t code, folly::StringPiece label) {
+  buf_->append("HTTP/1.1 ");
+  folly::toAppend(code, buf_);
+  buf_->push_back(' ');
+  buf_->append(label.data(), label.size());
+  buf_->append("\r\n");
+  // HTTP/1.1 connections are persistent unless either side says otherwise
+  if (!options_.keep_alive) {
+    buf_->append("Connection: close\r\n");
+  }
 }
 
-void HTTPResponseWriter::Header(const std::string& name, const std::tm* value) {
-  res_ << name << ": ";
-  std::string fmt = "%a, %d %b %Y %H:%M:%S %Z";
-  std::use_facet<std::time_put<char>>(res_.getloc())
-      .put(std::ostreambuf_iterator<char>(res_), res_, ' ', value, &fmt[0],
-           &fmt[0] + fmt.size());
-  res_ << "\r\n";
+/**
+ * Write |value| as an IMF-fixdate (RFC 7231 section 7.1.1.1). |value| must be
+ * in UTC.
+ */
+void HTTPResponseWriter::Header(folly::StringPiece name, const std::tm* value) {
+  buf_->append(name.data(), name.size());
+  buf_->append(": ");
+  buf_->append(kDayNames[value->tm_wday % 7]);
+  buf_->append(", ");
+  AppendTwoDigits(value->tm_mday, buf_);
+  buf_->push_back(' ');
+  buf_->append(kMonthNames[value->tm_mon % 12]);
+  buf_->push_back(' ');
+  folly::toAppend(value->tm_year + 1900, buf_);
+  buf_->push_back(' ');
+  AppendTwoDigits(value->tm_hour, buf_);
+  buf_->push_back(':');
+  AppendTwoDigits(value->tm_min, buf_);
+  buf_->push_back(':');
+  AppendTwoDigits(value->tm_sec, buf_);
+  buf_->append(" GMT\r\n");
 }
 
-void HTTPResponseWriter::Header(const std::string& name,
-                                const std::string& value) {
-  res_ << name << ": " << value << "\r\n";
+void HTTPResponseWriter::Header(folly::StringPiece name,
+                                folly::StringPiece value) {
+  buf_->append(name.data(), name.size());
+  buf_->append(": ");
+  buf_->append(value.data(), value.size());
+  buf_->append("\r\n");
 }
 
-void HTTPResponseWriter::Header(const std::string& name, const int64_t value) {
-  res_ << name << ": " << value << "\r\n";
+void HTTPResponseWriter::Header(folly::StringPiece name, const int64_t value) {
+  buf_->append(name.data(), name.size());
+  buf_->append(": ");
+  folly::toAppend(value, buf_);
+  buf_->append("\r\n");
 }
 
-void HTTPResponseWriter::Cookie(const std::string& name,
-                                const std::string& value,
-                                const std::string& domain, const time_t max_age,
+void HTTPResponseWriter::Cookie(folly::StringPiece name,
+                                folly::StringPiece value,
+                                folly::StringPiece domain, const time_t max_age,
                                 const bool http_only, const bool secure) {
-  res_ << "Set-Cookie: " << name << "=" << value;
-  if (domain != "") {
-    res_ << "; Domain=" << domain;
+  buf_->append("Set-Cookie: ");
+  buf_->append(name.data(), name.size());
+  buf_->push_back('=');
+  buf_->append(value.data(), value.size());
+  if (!domain.empty()) {
+    buf_->append("; Domain=");
+    buf_->append(domain.data(), domain.size());
   }
   if (max_age != 0) {
-    res_ << "; Max-Age=" << max_age;
+    buf_->append("; Max-Age=");
+    folly::toAppend(max_age, buf_);
   }
   if (http_only) {
-    res_ << "; HttpOnly";
+    buf_->append("; HttpOnly");
   }
   if (secure) {
-    res_ << "; Secure";
+    buf_->append("; Secure");
   }
-  res_ << "\r\n";
+  buf_->append("\r\n");
 }
 
 void HTTPResponseWriter::SessionCookie(const std::string& id) {
@@ -71,43 +152,45 @@ void HTTPResponseWriter::SessionCookie(const std::string& id) {
 }
 
 void HTTPResponseWriter::Body(const char* body, const size_t size) {
-  if (size < kResponseGzipMinSize) {
-    Header("Content-Length", size);
-    res_ << "\r\n" << folly::StringPiece(body, size) << std::flush;
+  if (size < kResponseCompressionMinSize) {
+    UncompressedBody(body, size);
     return;
   }
 
-  io::filtering_streambuf<io::input> filter;
-  filter.push(io::gzip_compressor());
-  filter.push(io::array_source{body, size});
+  Header("Vary", "Accept-Encoding");
+  if (options_.encoding == ContentEncoding::IDENTITY) {
+    UncompressedBody(body, size);
+    return;
+  }
 
-  std::string buf;
-  io::copy(filter, io::back_insert_device<std::string>{buf});
+  // reused between responses on the same thread to avoid reallocating
+  thread_local std::string buf;
+  if (!Compress(options_.encoding, body, size, &buf, compression_level_)) {
+    UncompressedBody(body, size);
+    return;
+  }
 
-  Header("Content-Encoding", "gzip");
-  Header("Content-Length", buf.size());
-  res_ << "\r\n" << buf << std::flush;
-}
+  Header("Content-Encoding", GetContentEncodingName(options_.encoding));
+  UncompressedBody(buf.data(), buf.size());
 
-void HTTPResponseWriter::JSON(const std::string& data) {
-  Header("Content-Type", "application/json");
-  Body(data.data(), data.size());
+  if (buf.capacity() > kMaxRetainedBufferSize) {
+    std::string().swap(buf);
+  }
 }
 
-void HTTPResponseWriter::LocalFile(const boost::filesystem::path& path) {
-  std::string abs_path = boost::filesystem::absolute(path).string();
-
-  time_t mtime = boost::filesystem::last_write_time(abs_path);
-  Header("Last-Modified", std::localtime(&mtime));
+void HTTPResponseWriter::UncompressedBody(const char* body, const size_t size) {
+  Header("Content-Length", size);
+  buf_->append("\r\n");
+  if (size != 0) {
+    buf_->append(body, size);
+  }
+}
 
-  MIMETypes mime_types;
-  Header("Content-Type", mime_types.Get(abs_path));
+void HTTPResponseWriter::EndHeaders() { buf_->append("\r\n"); }
 
-  std::ifstream file(abs_path, std::ios::binary);
-  std::vector<char> buf;
-  buf.assign(std::istreambuf_iterator<char>(file),
-             std::istreambuf_iterator<char>());
-  Body(reinterpret_cast<char*>(&buf.front()), buf.size());
+void HTTPResponseWriter::JSON(folly::StringPiece data) {
+  Header("Content-Type", "application/json");
+  Body(data.data(), data.size());
 }
 
 }  // namespace rustla2
@@ -1,67 +1,86 @@
 #pragma once
 
+#include <folly/Range.h>
 #include <uWS/uWS.h>
-#include <boost/filesystem/path.hpp>
 #include <ctime>
-#include <ostream>
-#include <sstream>
 #include <string>
 
-namespace rustla2 {
-
-class WSHTTPResponseProxy : public std::stringbuf {
- public:
-  explicit WSHTTPResponseProxy(uWS::HttpResponse* res) : res_(res) {}
+#include "Compression.h"
 
-  ~WSHTTPResponseProxy() {
-    if (res_) res_->end();
-  }
-
- protected:
-  virtual int sync() override final {
-    auto buf = str();
-    res_->write(buf.data(), buf.size());
-    str("");
-    return 0;
-  }
+namespace rustla2 {
 
- private:
-  uWS::HttpResponse* res_;
+struct HTTPResponseOptions {
+  // encoding used for bodies large enough to benefit from compression
+  ContentEncoding encoding;
+  // false if the connection is closed after this response
+  bool keep_alive;
 };
 
+/**
+ * Renders an HTTP response into a single contiguous buffer. Responses sent to
+ * a uWS::HttpResponse are rendered into a buffer reused by every writer on
+ * the thread and handed to the socket in one write when the writer is
+ * destroyed.
+ */
 class HTTPResponseWriter {
  public:
-  explicit HTTPResponseWriter(std::stringstream& res)
-      : proxy_(nullptr), res_(res.rdbuf()) {}
+  /**
+   * |options| are normally the request's, carrying its negotiated encoding
+   * and whether the connection stays open. Routes can trade CPU for size with
+   * |compression_level|.
+   */
+  explicit HTTPResponseWriter(
+      std::string* buf,
+      const HTTPResponseOptions& options = {ContentEncoding::IDENTITY, true},
+      const int compression_level = Z_DEFAULT_COMPRESSION);
+
+  explicit HTTPResponseWriter(
+      uWS::HttpResponse* res,
+      const HTTPResponseOptions& options = {ContentEncoding::IDENTITY, true},
+      const int compression_level = Z_DEFAULT_COMPRESSION);
+
+  ~HTTPResponseWriter();
 
-  explicit HTTPResponseWriter(uWS::HttpResponse* res)
-      : proxy_(res), res_(&proxy_) {}
+  HTTPResponseWriter(const HTTPResponseWriter&) = delete;
 
-  void Status(const uint32_t code, const std::string& label);
+  HTTPResponseWriter& operator=(const HTTPResponseWriter&) = delete;
 
-  void Header(const std::string& name, const std::tm* value);
+  void Status(const uint32_t code, folly::StringPiece label);
 
-  void Header(const std::string& name, const std::string& value);
+  void Header(folly::StringPiece name, const std::tm* value);
 
-  void Header(const std::string& name, const int64_t value);
+  void Header(folly::StringPiece name, folly::StringPiece value);
 
-  void Cookie(const std::string& name, const std::string& value,
-              const std::string& domain = "", const time_t max_age = 0,
+  void Header(folly::StringPiece name, const int64_t value);
+
+  void Cookie(folly::StringPiece name, folly::StringPiece value,
+              folly::StringPiece domain = "", const time_t max_age = 0,
               const bool http_only = false, const bool secure = false);
 
   void SessionCookie(const std::string& id);
 
-  void Body(const std::string& body = "") { Body(body.data(), body.size()); }
+  void Body(folly::StringPiece body = "") { Body(body.data(), body.size()); }
 
   void Body(const char* body, const size_t size);
 
-  void JSON(const std::string& data);
+  void UncompressedBody(const char* body, const size_t size);
+
+  /**
+   * End the headers of a response that has no body and mustn't send a
+   * Content-Length, such as a 304 (RFC 7230 section 3.3.2).
+   */
+  void EndHeaders();
 
-  void LocalFile(const boost::filesystem::path& path);
+  void JSON(folly::StringPiece data);
 
  private:
-  WSHTTPResponseProxy proxy_;
-  std::ostream res_;
+  uWS::HttpResponse* res_;
+  std::string* buf_;
+  // used instead of the thread's shared buffer if another writer holds it
+  std::string local_buf_;
+  bool owns_thread_buf_{false};
+  HTTPResponseOptions options_;
+  int compression_level_;
 };
 
 }  // namespace rustla2
@@ -1,141 +1,194 @@
 #pragma once
 
 #include <folly/String.h>
+#include <glog/logging.h>
 #include <uWS/uWS.h>
 #include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "HTTPRequest.h"
 
 namespace rustla2 {
 
-using PathParts = std::vector<folly::StringPiece>;
-using PathPartsIter = PathParts::iterator;
-
 using HTTPRouteHandler =
     std::function<void(uWS::HttpResponse *, HTTPRequest *)>;
 
-struct HTTPRoute {
-  HTTPRoute() : HTTPRoute("") {}
-
-  explicit HTTPRoute(const std::string &path)
-      : HTTPRoute(path, uWS::HttpMethod::METHOD_INVALID) {}
-
-  HTTPRoute(const std::string &path, const uWS::HttpMethod method)
-      : path(path),
-        method(method),
-        wildcard_path(path == "*"),
-        wildcard_subpath(path == "**") {}
-
-  const std::string path;
-  const uWS::HttpMethod method;
-  const bool wildcard_path = false;
-  const bool wildcard_subpath = false;
+// FNV-1a, so route lookups can hash request paths in place
+struct HTTPRoutePathHash {
+  std::size_t operator()(folly::StringPiece path) const {
+    std::size_t hash = 14695981039346656037ULL;
+    for (const auto c : path) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
 };
 
-struct HTTPRouteHash : public std::unary_function<HTTPRoute, std::size_t> {
-  std::size_t operator()(const HTTPRoute &k) const {
-    return std::hash<std::string>{}(k.path) ^
-           std::hash<std::underlying_type<uWS::HttpMethod>::type>{}(k.method);
+/**
+ * Handlers registered for one path, keyed by method. Routes rarely have more
+ * than a couple of methods so a linear scan beats hashing.
+ */
+class HTTPRouteMethods {
+ public:
+  void Set(const uWS::HttpMethod method, HTTPRouteHandler handler) {
+    for (auto &i : handlers_) {
+      if (i.first == method) {
+        i.second = handler;
+        return;
+      }
+    }
+    handlers_.emplace_back(method, handler);
   }
-};
 
-struct HTTPRouteEqual
-    : public std::binary_function<HTTPRoute, HTTPRoute, bool> {
-  bool operator()(const HTTPRoute &a, const HTTPRoute &b) const {
-    return a.path == b.path && a.method == b.method;
+  const HTTPRouteHandler *Find(const uWS::HttpMethod method) const {
+    for (const auto &i : handlers_) {
+      if (i.first == method) {
+        return &i.second;
+      }
+    }
+    return nullptr;
   }
-};
 
-using HTTPRouteMap =
-    std::unordered_map<HTTPRoute, std::unique_ptr<class HTTPRouterLayer>,
-                       HTTPRouteHash, HTTPRouteEqual>;
+ private:
+  std::vector<std::pair<uWS::HttpMethod, HTTPRouteHandler>> handlers_;
+};
 
-class HTTPRouterLayer {
+/**
+ * Trie of path segments for routes containing wildcards. `*` matches any one
+ * segment and a trailing `**` matches one or more segments. Children are
+ * looked up by hash and exact segments take precedence over wildcards.
+ */
+class HTTPRouteNode {
  public:
-  HTTPRouterLayer() = default;
-
-  explicit HTTPRouterLayer(HTTPRoute route) : route_(route) {}
-
-  explicit HTTPRouterLayer(HTTPRoute route, HTTPRouteHandler handler)
-      : route_(route), handler_(handler) {}
-
-  void InsertHandler(PathPartsIter first, PathPartsIter last,
-                     const uWS::HttpMethod method, HTTPRouteHandler handler) {
-    auto part = first + 1;
-    HTTPRouterLayer *layer = this;
-    for (auto j = last - 1; part != j; ++part) {
-      layer = layer->CreateLayer((*part).toString());
+  void Insert(folly::StringPiece path, const uWS::HttpMethod method,
+              HTTPRouteHandler handler) {
+    const auto end = path.find('/');
+    const bool is_last = end == folly::StringPiece::npos;
+    const auto segment = is_last ? path : path.subpiece(0, end);
+
+    if (is_last && segment == "**") {
+      subpath_handlers_.Set(method, handler);
+      return;
     }
 
-    HTTPRoute key((*part).toString(), method);
-    layer->layers_[key].reset(new HTTPRouterLayer(key, handler));
+    auto child = GetOrCreateChild(segment);
+    if (is_last) {
+      child->handlers_.Set(method, handler);
+    } else {
+      child->Insert(path.subpiece(end + 1), method, handler);
+    }
   }
 
-  bool Handle(PathPartsIter current, PathPartsIter last,
-              const uWS::HttpMethod method,
-              std::function<void(HTTPRouteHandler)> callback) const {
-    const auto next = current + 1;
-    const bool is_last = next == last;
-    const bool method_matches =
-        !is_last || (is_last && route_.method == method);
-    const bool path_matches = *current == route_.path || route_.wildcard_path ||
-                              route_.wildcard_subpath;
-
-    if (!path_matches || !method_matches) {
-      return false;
+  /**
+   * Find the handler for |path|, the remainder of the request path after the
+   * segments already matched by this node.
+   */
+  const HTTPRouteHandler *Find(folly::StringPiece path,
+                               const uWS::HttpMethod method) const {
+    const auto end = path.find('/');
+    const bool is_last = end == folly::StringPiece::npos;
+    const auto segment = is_last ? path : path.subpiece(0, end);
+    const auto rest = is_last ? folly::StringPiece() : path.subpiece(end + 1);
+
+    const HTTPRouteHandler *handler = nullptr;
+    auto child = children_.find(segment);
+    if (child != children_.end()) {
+      handler = child->second->Find(is_last, rest, method);
     }
-
-    if (handler_ != nullptr && (is_last || route_.wildcard_subpath)) {
-      callback(handler_);
-      return true;
+    if (handler == nullptr && wildcard_ != nullptr) {
+      handler = wildcard_->Find(is_last, rest, method);
     }
-
-    if (!is_last) {
-      for (const auto &i : layers_) {
-        if (i.second->Handle(next, last, method, callback)) {
-          return true;
-        }
-      }
+    if (handler == nullptr) {
+      handler = subpath_handlers_.Find(method);
     }
 
-    return false;
+    return handler;
   }
 
  private:
-  HTTPRouterLayer *CreateLayer(const std::string &path) {
-    HTTPRoute key(path);
-    if (layers_.find(key) == layers_.end()) {
-      layers_[key].reset(new HTTPRouterLayer(key));
+  const HTTPRouteHandler *Find(const bool is_last, folly::StringPiece rest,
+                               const uWS::HttpMethod method) const {
+    return is_last ? handlers_.Find(method) : Find(rest, method);
+  }
+
+  HTTPRouteNode *GetOrCreateChild(folly::StringPiece segment) {
+    if (segment == "*") {
+      if (wildcard_ == nullptr) {
+        wildcard_.reset(new HTTPRouteNode());
+      }
+      return wildcard_.get();
+    }
+
+    auto it = children_.find(segment);
+    if (it != children_.end()) {
+      return it->second.get();
     }
-    return layers_[key].get();
+
+    // keys point into the child's own copy of the segment
+    std::unique_ptr<HTTPRouteNode> child(new HTTPRouteNode());
+    child->segment_ = segment.toString();
+    auto node = child.get();
+    children_.emplace(folly::StringPiece(node->segment_), std::move(child));
+    return node;
   }
 
-  HTTPRoute route_;
-  const HTTPRouteHandler handler_ = 0;
-  HTTPRouteMap layers_;
+  std::string segment_;
+  HTTPRouteMethods handlers_;
+  HTTPRouteMethods subpath_handlers_;
+  std::unordered_map<folly::StringPiece, std::unique_ptr<HTTPRouteNode>,
+                     HTTPRoutePathHash>
+      children_;
+  std::unique_ptr<HTTPRouteNode> wildcard_;
 };
 
+/**
+ * Routes are compiled as they're registered at startup. Paths without
+ * wildcards, which includes every static file, resolve with a single hash
+ * lookup of the request path; the rest fall back to walking a trie. Neither
+ * allocates per request.
+ */
 class HTTPRouter {
  public:
   bool Dispatch(uWS::HttpResponse *res, HTTPRequest *req) {
-    return Dispatch(req->GetPath(), req->GetMethod(),
-                    [&](HTTPRouteHandler handler) { handler(res, req); });
+    const auto handler = Find(req->GetPathString(), req->GetMethod());
+    if (handler == nullptr) {
+      return false;
+    }
+
+    (*handler)(res, req);
+    return true;
   }
 
-  bool Dispatch(PathParts parts, const uWS::HttpMethod method,
-                std::function<void(HTTPRouteHandler)> callback) {
-    return layer_.Handle(parts.begin(), parts.end(), method, callback);
+  bool Dispatch(folly::StringPiece path, const uWS::HttpMethod method,
+                std::function<void(const HTTPRouteHandler &)> callback) {
+    const auto handler = Find(path, method);
+    if (handler == nullptr) {
+      return false;
+    }
+
+    callback(*handler);
+    return true;
   }
 
-  bool Dispatch(const std::string &path, const uWS::HttpMethod method,
-                std::function<void(HTTPRouteHandler)> callback) {
-    PathParts parts;
-    folly::split('/', path, parts);
-    return Dispatch(parts, method, callback);
+  const HTTPRouteHandler *Find(folly::StringPiece path,
+                               const uWS::HttpMethod method) const {
+    auto exact = exact_routes_.find(path);
+    if (exact != exact_routes_.end()) {
+      auto handler = exact->second.Find(method);
+      if (handler != nullptr) {
+        return handler;
+      }
+    }
+
+    if (!path.removePrefix('/')) {
+      return nullptr;
+    }
+    return wildcard_routes_.Find(path, method);
   }
 
   void Get(const std::string &path, HTTPRouteHandler handler) {
@@ -184,12 +237,38 @@ class HTTPRouter {
 
   void InsertHandler(const std::string &path, const uWS::HttpMethod method,
                      HTTPRouteHandler handler) {
-    PathParts parts;
-    folly::split('/', path, parts);
-    layer_.InsertHandler(parts.begin(), parts.end(), method, handler);
+    folly::StringPiece route(path);
+    if (!route.removePrefix('/')) {
+      LOG(ERROR) << "HTTPRouter ignoring route without a leading slash "
+                 << path;
+      return;
+    }
+
+    std::vector<folly::StringPiece> segments;
+    folly::split('/', route, segments);
+    for (const auto &segment : segments) {
+      if (segment == "*" || segment == "**") {
+        wildcard_routes_.Insert(route, method, handler);
+        return;
+      }
+    }
+
+    auto it = exact_routes_.find(path);
+    if (it == exact_routes_.end()) {
+      // keys point into paths owned by the router
+      exact_paths_.emplace_back(new std::string(path));
+      it = exact_routes_
+               .emplace(folly::StringPiece(*exact_paths_.back()),
+                        HTTPRouteMethods())
+               .first;
+    }
+    it->second.Set(method, handler);
   }
 
-  HTTPRouterLayer layer_;
+  std::vector<std::unique_ptr<std::string>> exact_paths_;
+  std::unordered_map<folly::StringPiece, HTTPRouteMethods, HTTPRoutePathHash>
+      exact_routes_;
+  HTTPRouteNode wildcard_routes_;
 };
 
 }  // namespace rustla2
@@ -3,33 +3,64 @@
 #include <folly/String.h>
 #include <glog/logging.h>
 #include <chrono>
+#include <vector>
 
 #include "Config.h"
 #include "HTTPResponseWriter.h"
 
 namespace rustla2 {
 
-HTTPService::HTTPService(std::shared_ptr<DB> db, uWS::Hub *hub)
+namespace {
+
+// Shorter than the period of uWS's own HTTP timer so every connection still
+// within its keep-alive timeout is vouched for between two of its ticks.
+const uint64_t kIdleConnectionCheckInterval = 500;
+
+}  // namespace
+
+HTTPService::HTTPService(std::shared_ptr<DB> db,
+                         std::shared_ptr<Broadcaster> broadcaster,
+                         std::shared_ptr<StaticAssetStore> static_assets,
+                         uWS::Hub *hub)
     : db_(db),
-      api_service_(db_),
+      hub_(hub),
+      idle_timer_(hub->getLoop()),
+      keep_alive_timeout_(Config::Get().GetHTTPKeepAliveTimeout()),
+      keep_alive_max_requests_(Config::Get().GetHTTPKeepAliveMaxRequests()),
+      api_service_(db_, broadcaster),
       admin_service_(db_),
       auth_service_(db_),
-      static_service_(Config::Get().GetPublicPath()) {
+      static_service_(static_assets) {
   api_service_.RegisterRoutes(&router_);
   admin_service_.RegisterRoutes(&router_);
   auth_service_.RegisterRoutes(&router_);
-  static_service_.RegisterRoutes(&router_);
+
+  idle_timer_.setData(this);
+  idle_timer_.start(
+      [](Timer *timer) {
+        static_cast<HTTPService *>(timer->getData())->CloseIdleConnections();
+      },
+      kIdleConnectionCheckInterval, kIdleConnectionCheckInterval);
+
+  // a new socket may reuse the address of one freed by a WebSocket upgrade
+  hub->onHttpConnection(
+      [&](HTTPSocket *socket) { connections_.erase(socket); });
+
+  hub->onHttpDisconnection(
+      [&](HTTPSocket *socket) { connections_.erase(socket); });
 
   hub->onHttpRequest([&](uWS::HttpResponse *res, uWS::HttpRequest uws_req,
                          char *data, size_t length, size_t remaining_bytes) {
     HTTPRequest req(uws_req);
+    auto connection = TrackRequest(res, &req);
 
     if (RejectBannedIP(res, &req)) {
+      connection->closing = true;
       return;
     }
 
     if (!router_.Dispatch(res, &req)) {
-      static_service_.ServeIndex(res);
+      static_service_.Serve(res, &req);
       return;
     }
     req.WritePostData(data, length, remaining_bytes);
@@ -61,9 +92,15 @@ HTTPService::HTTPService(std::shared_ptr<DB> db, uWS::Hub *hub)
   });
 }
 
+HTTPService::~HTTPService() {
+  idle_timer_.stop();
+  idle_timer_.close();
+}
+
 bool HTTPService::RejectBannedIP(uWS::HttpResponse *res, HTTPRequest *req) {
   if (db_->GetBannedIPs()->Contains(req->GetClientIPHeader())) {
-    HTTPResponseWriter writer(res);
+    req->SetKeepAlive(false);
+    HTTPResponseWriter writer(res, req->GetResponseOptions());
     writer.Status(403, "Forbidden");
     writer.Body();
     return true;
@@ -72,4 +109,70 @@ bool HTTPService::RejectBannedIP(uWS::HttpResponse *res, HTTPRequest *req) {
   return false;
 }
 
+/**
+ * Count a request against its connection's keep-alive budget. The response to
+ * the last request allowed on a connection, or to a client that asked to
+ * close, says so and the connection is closed once it has been sent.
+ */
+HTTPConnection *HTTPService::TrackRequest(uWS::HttpResponse *res,
+                                          HTTPRequest *req) {
+  auto &connection = connections_[res->httpSocket];
+  connection.last_active = std::chrono::steady_clock::now();
+  ++connection.requests;
+
+  if (connection.closing || !req->GetKeepAlive() ||
+      connection.requests >= keep_alive_max_requests_) {
+    connection.closing = true;
+    req->SetKeepAlive(false);
+  }
+
+  return &connection;
+}
+
+/**
+ * Close connections that have finished their final response or have been
+ * idle for longer than the keep-alive timeout. Connections with responses
+ * still in flight, including requests waiting on post data, are left alone.
+ *
+ * uWS runs its own timer that terminates any HTTP socket idle across two of
+ * its one second ticks, which would cut every keep-alive short. Connections
+ * within their timeout have its deadline cleared here instead; connections
+ * that haven't sent a request yet are left to it.
+ *
+ * Only sockets uWS still lists are visited. One that was upgraded to a
+ * WebSocket is freed by uWS without a disconnection callback, so its entry is
+ * dropped rather than dereferenced.
+ */
+void HTTPService::CloseIdleConnections() {
+  const auto now = std::chrono::steady_clock::now();
+
+  std::unordered_map<HTTPSocket *, HTTPConnection> live;
+  std::vector<HTTPSocket *> idle;
+  hub_->getDefaultGroup<uWS::SERVER>().forEachHttpSocket(
+      [&](HTTPSocket *socket) {
+        auto it = connections_.find(socket);
+        if (it == connections_.end()) {
+          return;
+        }
+        live.insert(*it);
+
+        if (socket->outstandingResponsesHead != nullptr) {
+          return;
+        }
+
+        if (it->second.closing ||
+            now - it->second.last_active >= keep_alive_timeout_) {
+          idle.push_back(socket);
+        } else {
+          socket->missedDeadline = false;
+        }
+      });
+  connections_.swap(live);
+
+  // terminating triggers onHttpDisconnection, which erases from connections_
+  for (auto socket : idle) {
+    socket->terminate();
+  }
+}
+
 }  // namespace rustla2
@@ -1,19 +1,37 @@
 #include <uWS/uWS.h>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <unordered_map>
 
 #include "APIHTTPService.h"
 #include "AdminHTTPService.h"
 #include "AuthHTTPService.h"
+#include "Broadcaster.h"
 #include "DB.h"
 #include "HTTPRequest.h"
 #include "HTTPRouter.h"
+#include "StaticAssets.h"
 #include "StaticHTTPService.h"
 
 namespace rustla2 {
 
+using HTTPSocket = uWS::HttpSocket<uWS::SERVER>;
+
+struct HTTPConnection {
+  uint32_t requests{0};
+  std::chrono::steady_clock::time_point last_active;
+  // set once a response has told the client the connection will close
+  bool closing{false};
+};
+
 class HTTPService {
  public:
-  HTTPService(std::shared_ptr<DB> db, uWS::Hub *hub);
+  HTTPService(std::shared_ptr<DB> db, std::shared_ptr<Broadcaster> broadcaster,
+              std::shared_ptr<StaticAssetStore> static_assets,
+              uWS::Hub *hub);
+
+  ~HTTPService();
 
  private:
   HTTPRequest *LoadHTTPRequestFromUserData(uWS::HttpResponse *res) {
@@ -23,7 +41,17 @@ class HTTPService {
 
   bool RejectBannedIP(uWS::HttpResponse *res, HTTPRequest *req);
 
+  HTTPConnection *TrackRequest(uWS::HttpResponse *res, HTTPRequest *req);
+
+  void CloseIdleConnections();
+
   std::shared_ptr<DB> db_;
+  uWS::Hub *hub_;
+  // sockets that have sent at least one request
+  std::unordered_map<HTTPSocket *, HTTPConnection> connections_;
+  Timer idle_timer_;
+  const std::chrono::milliseconds keep_alive_timeout_;
+  const uint32_t keep_alive_max_requests_;
   HTTPRouter router_;
   APIHTTPService api_service_;
   AdminHTTPService admin_service_;
@@ -20,15 +20,21 @@ void IPRange::WriteJSON(rapidjson::Writer<rapidjson::StringBuffer>* writer) {
   writer->EndObject();
 }
 
-IPRanges::IPRanges(sqlite::database db, const std::string& table_name)
-    : db_(db), table_name_(table_name) {
+IPRanges::IPRanges(sqlite::database db, sqlite::database reader,
+                   std::shared_ptr<PreparedStatements> statements,
+                   std::shared_ptr<DBWriter> writer,
+                   const std::string& table_name)
+    : db_(db),
+      statements_(statements),
+      writer_(writer),
+      table_name_(table_name) {
   InitTable();
 
-  db_ << folly::sformat("SELECT MAX(id) + 1 FROM {}", table_name_) >>
+  reader << folly::sformat("SELECT MAX(id) + 1 FROM {}", table_name_) >>
       [&](uint64_t next_id) { next_id_ = next_id; };
 
   auto sql = folly::sformat("SELECT `start`, `end` FROM `{}`", table_name_);
-  auto query = db_ << sql;
+  auto query = reader << sql;
 
   query >> [&](const std::string start, const std::string end) {
     ranges_.insert(Value::closed(GetAddressValue(start), GetAddressValue(end)));
@@ -111,8 +117,10 @@ std::shared_ptr<IPRange> IPRanges::Emplace(const std::string& range_start_str,
           datetime()
         );
       )sql";
-    db_ << folly::sformat(sql, table_name_) << id << range_start_str
-        << range_end_str << note;
+    auto connection_lock = writer_->LockConnection();
+    auto query = statements_->Get(folly::sformat(sql, table_name_));
+    query << id << range_start_str << range_end_str << note;
+    query.Execute();
   } catch (const sqlite::sqlite_exception& e) {
     LOG(ERROR) << "error storing ip range "
                << "start: " << range_start_str << ", "
@@ -141,7 +149,13 @@ std::shared_ptr<IPRange> IPRanges::Emplace(const std::string& range_start_str,
 }
 
 bool IPRanges::EraseByID(const uint64_t id) {
-  db_ << folly::sformat("DELETE FROM `{0}` WHERE id = ?", table_name_) << id;
+  {
+    auto connection_lock = writer_->LockConnection();
+    auto query = statements_->Get(
+        folly::sformat("DELETE FROM `{0}` WHERE id = ?", table_name_));
+    query << id;
+    query.Execute();
+  }
 
   boost::upgrade_lock<boost::shared_mutex> read_lock(lock_);
   auto it = data_.find(id);
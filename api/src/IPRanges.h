@@ -5,6 +5,7 @@
 #include <rapidjson/writer.h>
 #include <sqlite_modern_cpp.h>
 #include <atomic>
+#include <chrono>
 #include <boost/asio/ip/address.hpp>
 #include <boost/icl/interval_set.hpp>
 #include <boost/thread/shared_mutex.hpp>
@@ -13,6 +14,8 @@
 #include <memory>
 
 #include "Bans.h"
+#include "DBWriter.h"
+#include "PreparedStatements.h"
 #include "Status.h"
 
 namespace rustla2 {
@@ -41,7 +44,16 @@ class IPRanges {
   using ValueRanges = boost::icl::interval_set<unsigned __int128>;
   using Value = ValueRanges::interval_type;
 
-  IPRanges(sqlite::database db, const std::string& table_name);
+  IPRanges(sqlite::database db, const std::string& table_name)
+      : IPRanges(db, db, std::make_shared<PreparedStatements>(db),
+                 std::make_shared<DBWriter>(db, std::chrono::seconds(1)),
+                 table_name) {}
+
+  // Existing ranges are read through |reader|. Ranges are written inline,
+  // holding |writer|'s connection lock.
+  IPRanges(sqlite::database db, sqlite::database reader,
+           std::shared_ptr<PreparedStatements> statements,
+           std::shared_ptr<DBWriter> writer, const std::string& table_name);
 
   void InitTable();
 
@@ -94,6 +106,8 @@ class IPRanges {
   uint64_t GetNextID() { return next_id_++; }
 
   sqlite::database db_;
+  std::shared_ptr<PreparedStatements> statements_;
+  std::shared_ptr<DBWriter> writer_;
   const std::string table_name_;
   boost::shared_mutex lock_;
   std::atomic<uint64_t> next_id_{0};
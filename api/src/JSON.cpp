@@ -20,16 +20,14 @@ std::ostream& operator<<(std::ostream& stream, const StringRef& status) {
   return stream;
 }
 
-rapidjson::Document Parse(const char* data, const size_t length,
-                          const std::string& schema_json, Status* status) {
-  rapidjson::Document input;
-  input.Parse(data, length);
+namespace {
 
+void Validate(const rapidjson::Document& input, const std::string& schema_json,
+              Status* status) {
   if (input.HasParseError()) {
     new (status) Status(StatusCode::JSON_PARSE_ERROR, "malformed json",
                         rapidjson::GetParseError_En(input.GetParseError()));
-
-    return input;
+    return;
   }
 
   if (!schema_json.empty()) {
@@ -38,7 +36,7 @@ rapidjson::Document Parse(const char* data, const size_t length,
     if (schema.HasParseError()) {
       new (status) Status(StatusCode::JSON_SCHEMA_ERROR, "invalid json schema",
                           rapidjson::GetParseError_En(schema.GetParseError()));
-      return input;
+      return;
     }
 
     rapidjson::SchemaDocument schema_document(schema);
@@ -57,11 +55,28 @@ rapidjson::Document Parse(const char* data, const size_t length,
 
       new (status) Status(StatusCode::VALIDATION_ERROR,
                           "json validation failed", error_details.str());
-      return input;
+      return;
     }
   }
 
   if (status) *status = Status::OK;
+}
+
+}  // namespace
+
+rapidjson::Document Parse(const char* data, const size_t length,
+                          const std::string& schema_json, Status* status) {
+  rapidjson::Document input;
+  input.Parse(data, length);
+  Validate(input, schema_json, status);
+  return input;
+}
+
+rapidjson::Document ParseInsitu(char* data, const std::string& schema_json,
+                                Status* status) {
+  rapidjson::Document input;
+  input.ParseInsitu(data);
+  Validate(input, schema_json, status);
   return input;
 }
 
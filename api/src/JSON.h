@@ -68,5 +68,12 @@ rapidjson::Document Parse(const char* data, const size_t length,
                           const std::string& schema_json = "",
                           Status* status = nullptr);
 
+/**
+ * Parse the null terminated |data| in place. Strings in the returned document
+ * point into |data|, which must outlive it.
+ */
+rapidjson::Document ParseInsitu(char* data, const std::string& schema_json = "",
+                                Status* status = nullptr);
+
 }  // namespace json
 }  // namespace rustla2
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "PollSchedule.h"
+
+#include <algorithm>
+
+namespace rustla2 {
+
+PollSchedule::PollSchedule(const Clock::duration min_interval,
+                           const Clock::duration max_interval)
+    : min_interval_(min_interval),
+      max_interval_(std::max(min_interval, max_interval)) {}
+
+void PollSchedule::Update(
+    const std::unordered_map<uint64_t, uint64_t>& rustlers,
+    const Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(lock_);
+
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (rustlers.count(it->first) == 0) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  for (const auto& i : rustlers) {
+    auto it = entries_.find(i.first);
+    if (it == entries_.end()) {
+      auto& entry = entries_[i.first];
+      entry = Entry{min_interval_, i.second, 0};
+      Schedule(i.first, &entry, now);
+    } else {
+      it->second.rustlers = i.second;
+    }
+  }
+
+  PopStale();
+}
+
+std::vector<uint64_t> PollSchedule::PopDue(const Clock::time_point now,
+                                           const Clock::time_point deadline) {
+  std::lock_guard<std::mutex> lock(lock_);
+
+  std::vector<uint64_t> due;
+  for (PopStale(); !heap_.empty() && heap_.top().due <= deadline;
+       PopStale()) {
+    due.push_back(heap_.top().id);
+    heap_.pop();
+  }
+
+  // rescheduled only once all are popped so a stream can't come due twice
+  for (const auto id : due) {
+    auto& entry = entries_[id];
+    const auto rustlers =
+        static_cast<Clock::rep>(std::max<uint64_t>(entry.rustlers, 1));
+    const auto longest = max_interval_ / rustlers;
+    entry.interval = std::max(
+        min_interval_, std::min({entry.interval * 2, max_interval_, longest}));
+    Schedule(id, &entry, now + entry.interval);
+  }
+
+  return due;
+}
+
+void PollSchedule::MarkChanged(const uint64_t id,
+                               const Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(lock_);
+
+  auto it = entries_.find(id);
+  if (it == entries_.end()) {
+    return;
+  }
+
+  it->second.interval = min_interval_;
+  Schedule(id, &it->second, now + min_interval_);
+}
+
+PollSchedule::Clock::time_point PollSchedule::GetNextDue() {
+  std::lock_guard<std::mutex> lock(lock_);
+  PopStale();
+  return heap_.empty() ? Clock::time_point::max() : heap_.top().due;
+}
+
+size_t PollSchedule::GetSize() {
+  std::lock_guard<std::mutex> lock(lock_);
+  return entries_.size();
+}
+
+void PollSchedule::Schedule(const uint64_t id, Entry* entry,
+                            const Clock::time_point due) {
+  entry->generation = ++generation_;
+  heap_.push(HeapItem{due, id, entry->generation});
+}
+
+void PollSchedule::PopStale() {
+  while (!heap_.empty()) {
+    const auto& top = heap_.top();
+    auto it = entries_.find(top.id);
+    if (it != entries_.end() && it->second.generation == top.generation) {
+      return;
+    }
+    heap_.pop();
+  }
+}
+
+}  // namespace rustla2
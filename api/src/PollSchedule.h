@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace rustla2 {
+
+/**
+ * Decides when each stream is next checked by the ServicePoller. Streams are
+ * kept in a min-heap keyed by the time they're next due. A stream that
+ * changed is checked again after |min_interval|, and each check that finds
+ * it unchanged doubles its interval up to |max_interval|. Streams with more
+ * rustlers are never backed off as far: the longest interval is divided by
+ * their rustler count.
+ */
+class PollSchedule {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  PollSchedule(const Clock::duration min_interval,
+               const Clock::duration max_interval);
+
+  /**
+   * Track exactly the streams in |rustlers|, a map of stream id to rustler
+   * count. Streams new to the schedule are due at |now|.
+   */
+  void Update(const std::unordered_map<uint64_t, uint64_t>& rustlers,
+              const Clock::time_point now);
+
+  /**
+   * Return the streams due by |deadline| and schedule their next check from
+   * |now| as though it will find them unchanged.
+   */
+  std::vector<uint64_t> PopDue(const Clock::time_point now,
+                               const Clock::time_point deadline);
+
+  /**
+   * Check stream |id| again after the shortest interval, since it changed
+   * when last checked at |now|.
+   */
+  void MarkChanged(const uint64_t id, const Clock::time_point now);
+
+  // Clock::time_point::max() if no streams are scheduled.
+  Clock::time_point GetNextDue();
+
+  size_t GetSize();
+
+ private:
+  struct Entry {
+    Clock::duration interval;
+    uint64_t rustlers;
+    // matches only the newest heap item for the stream
+    uint64_t generation;
+  };
+
+  struct HeapItem {
+    Clock::time_point due;
+    uint64_t id;
+    uint64_t generation;
+
+    bool operator>(const HeapItem& other) const { return due > other.due; }
+  };
+
+  void Schedule(const uint64_t id, Entry* entry, const Clock::time_point due);
+
+  // Drop heap items left behind by rescheduled or removed streams.
+  void PopStale();
+
+  const Clock::duration min_interval_;
+  const Clock::duration max_interval_;
+  std::mutex lock_;
+  std::unordered_map<uint64_t, Entry> entries_;
+  // shared by every stream so a stream that's removed and added again can't
+  // match heap items from before it was removed
+  uint64_t generation_{0};
+  std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>>
+      heap_;
+};
+
+}  // namespace rustla2
@@ -0,0 +1,23 @@
+#include "PreparedStatements.h"
+
+namespace rustla2 {
+
+PreparedStatement PreparedStatements::Get(const std::string& sql) {
+  Entry* entry;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = statements_.find(sql);
+    if (it == statements_.end()) {
+      std::unique_ptr<Entry> created(new Entry(db_ << sql));
+      // cached statements are only ever run explicitly, never by the
+      // binder's destructor
+      created->statement.used(true);
+      it = statements_.emplace(sql, std::move(created)).first;
+    }
+    entry = it->second.get();
+  }
+
+  return PreparedStatement(&entry->lock, &entry->statement);
+}
+
+}  // namespace rustla2
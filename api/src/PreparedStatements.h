@@ -0,0 +1,76 @@
+#pragma once
+
+#include <sqlite_modern_cpp.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace rustla2 {
+
+/**
+ * Exclusive use of a cached statement. Values bound with << replace the ones
+ * from its last execution. The statement is released for other threads when
+ * this is destroyed.
+ */
+class PreparedStatement {
+ public:
+  PreparedStatement(std::mutex* lock, sqlite::database_binder* statement)
+      : lock_(*lock), statement_(statement) {}
+
+  template <typename T>
+  PreparedStatement& operator<<(const T& value) {
+    *statement_ << value;
+    return *this;
+  }
+
+  // Run a statement that doesn't return rows.
+  void Execute() { statement_->execute(); }
+
+  // Run the statement, calling |callback| with each row.
+  template <typename F>
+  void operator>>(F&& callback) {
+    *statement_ >> std::forward<F>(callback);
+  }
+
+ private:
+  std::unique_lock<std::mutex> lock_;
+  sqlite::database_binder* statement_;
+};
+
+/**
+ * Statements compiled once per connection and reused, keyed by their SQL, so
+ * hot queries skip SQLite's parser and planner. Each statement can be used by
+ * one thread at a time; different statements can run concurrently as far as
+ * the connection allows.
+ */
+class PreparedStatements {
+ public:
+  explicit PreparedStatements(sqlite::database db) : db_(db) {}
+
+  PreparedStatements(const PreparedStatements&) = delete;
+
+  PreparedStatements& operator=(const PreparedStatements&) = delete;
+
+  /**
+   * Return the statement for |sql|, compiling it on first use. Throws
+   * sqlite::sqlite_exception if |sql| doesn't compile.
+   */
+  PreparedStatement Get(const std::string& sql);
+
+ private:
+  struct Entry {
+    explicit Entry(sqlite::database_binder&& statement)
+        : statement(std::move(statement)) {}
+
+    std::mutex lock;
+    sqlite::database_binder statement;
+  };
+
+  sqlite::database db_;
+  std::mutex lock_;
+  std::unordered_map<std::string, std::unique_ptr<Entry>> statements_;
+};
+
+}  // namespace rustla2
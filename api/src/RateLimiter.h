@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace rustla2 {
+
+/**
+ * Token bucket shared by the threads calling one upstream API. Callers that
+ * find the bucket empty reserve the next token and sleep until it's due, so
+ * waiting threads are served in the order they arrived.
+ */
+class RateLimiter {
+ public:
+  // Allow |rate| calls per second on average and up to |burst| at once. A
+  // rate of 0 disables limiting.
+  RateLimiter(const double rate, const double burst)
+      : rate_(rate),
+        burst_(std::max(burst, 1.0)),
+        tokens_(burst_),
+        last_refill_(std::chrono::steady_clock::now()) {}
+
+  void Acquire() {
+    if (rate_ <= 0) {
+      return;
+    }
+
+    std::chrono::duration<double> wait(0);
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      const auto now = std::chrono::steady_clock::now();
+      const std::chrono::duration<double> elapsed = now - last_refill_;
+      tokens_ = std::min(burst_, tokens_ + elapsed.count() * rate_);
+      last_refill_ = now;
+
+      tokens_ -= 1;
+      if (tokens_ < 0) {
+        wait = std::chrono::duration<double>(-tokens_ / rate_);
+      }
+    }
+
+    if (wait.count() > 0) {
+      std::this_thread::sleep_for(wait);
+    }
+  }
+
+ private:
+  const double rate_;
+  const double burst_;
+  std::mutex lock_;
+  // goes negative while callers are waiting on reserved tokens
+  double tokens_;
+  std::chrono::steady_clock::time_point last_refill_;
+};
+
+}  // namespace rustla2
@@ -1,11 +1,44 @@
 #include "ServicePoller.h"
 
+#include <glog/logging.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
 #include "AngelThumpClient.h"
 #include "Config.h"
+#include "Curl.h"
 
 namespace rustla2 {
 
-ServicePoller::ServicePoller(std::shared_ptr<DB> db) : db_(db) {
+namespace {
+
+// Streams due this soon are checked early so they can share pages.
+constexpr std::chrono::seconds kCoalesceWindow(5);
+
+// How often streams that gained or lost rustlers are added to or removed
+// from the schedule.
+constexpr std::chrono::seconds kRescanInterval(1);
+
+// How often the upstream connection totals are logged.
+constexpr std::chrono::minutes kStatsInterval(10);
+
+}  // namespace
+
+ServicePoller::ServicePoller(std::shared_ptr<DB> db)
+    : db_(db),
+      workers_(Config::Get().GetLivecheckConcurrency()),
+      schedule_(
+          std::chrono::milliseconds(Config::Get().GetLivecheckInterval()),
+          std::chrono::milliseconds(Config::Get().GetLivecheckMaxInterval())),
+      twitch_limiter_(Config::Get().GetTwitchRateLimit(),
+                      Config::Get().GetTwitchRateLimit()),
+      youtube_limiter_(Config::Get().GetYouTubeRateLimit(),
+                       Config::Get().GetYouTubeRateLimit()),
+      angelthump_limiter_(Config::Get().GetAngelThumpRateLimit(),
+                          Config::Get().GetAngelThumpRateLimit()) {
   twitch::ClientConfig twitch_config{
       .client_id = Config::Get().GetTwitchClientID(),
       .client_secret = Config::Get().GetTwitchClientSecret(),
@@ -18,35 +51,160 @@ ServicePoller::ServicePoller(std::shared_ptr<DB> db) : db_(db) {
 }
 
 void ServicePoller::Run() {
-  auto streams = db_->GetStreams()->GetAllWithRustlers();
-  for (const auto& stream : streams) {
-    ChannelState state;
-    Status status;
-
-    auto channel = stream->GetChannel();
-    if (channel->GetService() == kTwitchService) {
-      status = CheckTwitchStream(channel->GetChannel(), &state);
-    } else if (channel->GetService() == kTwitchVODService) {
-      status = CheckTwitchVOD(channel->GetChannel(), &state);
-    } else if (channel->GetService() == kAngelThumpService) {
-      status = CheckAngelThump(channel->GetChannel(), &state);
-    } else if (channel->GetService() == kYouTubeService) {
-      status = CheckYouTube(channel->GetChannel(), &state);
-    }
+  const auto now = PollSchedule::Clock::now();
+
+  std::unordered_map<uint64_t, uint64_t> rustlers;
+  std::unordered_map<uint64_t, std::shared_ptr<Stream>> streams_by_id;
+  for (auto& stream : db_->GetStreams()->GetAllWithRustlers()) {
+    rustlers[stream->GetID()] = stream->GetRustlerCount();
+    streams_by_id[stream->GetID()] = stream;
+  }
+  schedule_.Update(rustlers, now);
+
+  std::vector<std::shared_ptr<Stream>> streams;
+  for (const auto id : schedule_.PopDue(now, now + kCoalesceWindow)) {
+    streams.push_back(streams_by_id[id]);
+  }
+  if (streams.empty()) {
+    return;
+  }
 
-    if (status.Ok()) {
-      stream->SetIsLive(state.live);
-      stream->SetThumbnail(state.thumbnail);
-      stream->SetViewerCount(state.viewers);
+  std::atomic<uint64_t> saved{0};
+  std::atomic<uint64_t> skipped{0};
+
+  auto update = [&](Stream* stream, const ChannelState& state) {
+    bool changed = stream->SetIsLive(state.live);
+    changed |= stream->SetThumbnail(state.thumbnail);
+    changed |= stream->SetViewerCount(state.viewers);
+    if (changed) {
       stream->Save();
+      ++saved;
+      schedule_.MarkChanged(stream->GetID(), PollSchedule::Clock::now());
+    } else {
+      ++skipped;
+    }
+  };
+
+  // Services with a batch endpoint are split into pages checked with one
+  // request each. Each page is keyed by channel name so results can be
+  // matched back to their streams.
+  using Page = std::unordered_map<std::string, std::shared_ptr<Stream>>;
+  std::vector<Page> twitch_pages;
+  std::vector<Page> youtube_pages;
+  auto add_to_page = [](std::vector<Page>* pages, const size_t page_size,
+                        std::shared_ptr<Stream> stream) {
+    if (pages->empty() || pages->back().size() == page_size) {
+      pages->emplace_back();
+    }
+    pages->back()[stream->GetChannel()->GetChannel()] = stream;
+  };
+
+  std::vector<std::function<void()>> tasks;
+  for (auto& stream : streams) {
+    const auto service = stream->GetChannel()->GetService();
+    if (service == kTwitchService) {
+      add_to_page(&twitch_pages, twitch::kMaxStreamsPerRequest, stream);
+    } else if (service == kYouTubeService) {
+      add_to_page(&youtube_pages, youtube::kMaxVideosPerRequest, stream);
+    } else {
+      tasks.emplace_back([this, stream, &update]() {
+        ChannelState state;
+        if (CheckStream(stream.get(), &state).Ok()) {
+          update(stream.get(), state);
+        }
+      });
+    }
+  }
+
+  using BatchCheck = const Status (ServicePoller::*)(
+      const std::vector<std::string>&,
+      std::unordered_map<std::string, ChannelState>*);
+  auto add_page_tasks = [&](const std::vector<Page>& pages,
+                            const BatchCheck check) {
+    for (const auto& page : pages) {
+      tasks.emplace_back([this, &page, check, &update]() {
+        std::vector<std::string> names;
+        names.reserve(page.size());
+        for (const auto& i : page) {
+          names.push_back(i.first);
+        }
+
+        std::unordered_map<std::string, ChannelState> states;
+        auto status = (this->*check)(names, &states);
+        if (!status.Ok()) {
+          LOG(ERROR) << "ServicePoller failed to check " << names.size()
+                     << " streams: " << status.GetErrorMessage();
+        }
+        for (const auto& i : states) {
+          update(page.at(i.first).get(), i.second);
+        }
+      });
+    }
+  };
+  add_page_tasks(twitch_pages, &ServicePoller::CheckTwitchStreams);
+  add_page_tasks(youtube_pages, &ServicePoller::CheckYouTubeVideos);
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto task_count = tasks.size();
+  workers_.RunAll(std::move(tasks));
+
+  saved_count_ += saved;
+  skipped_count_ += skipped;
+  DLOG(INFO) << "ServicePoller checked " << streams.size() << " of "
+             << rustlers.size() << " streams with " << task_count
+             << " task(s) in "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count()
+             << "ms on " << workers_.GetSize() << " thread(s), " << saved
+             << " changed, " << skipped << " unchanged";
+}
+
+void ServicePoller::Loop() {
+  auto next_stats = PollSchedule::Clock::now() + kStatsInterval;
+  while (true) {
+    Run();
+
+    const auto now = PollSchedule::Clock::now();
+    if (now >= next_stats) {
+      next_stats = now + kStatsInterval;
+      LOG(INFO) << "ServicePoller found " << saved_count_
+                << " changed and " << skipped_count_
+                << " unchanged streams since startup";
+
+      const auto& curl = CurlPool::Get();
+      LOG(INFO) << "upstream APIs sent " << curl.GetTransferCount()
+                << " responses since startup, " << curl.GetReusedCount()
+                << " on reused connections, opening " << curl.GetConnectCount()
+                << " connections from " << curl.GetHandleCount() << " handles";
     }
+
+    std::this_thread::sleep_until(
+        std::min(schedule_.GetNextDue(), now + kRescanInterval));
   }
 }
 
+const Status ServicePoller::CheckStream(Stream* stream, ChannelState* state) {
+  auto channel = stream->GetChannel();
+  if (channel->GetService() == kTwitchService) {
+    return CheckTwitchStream(channel->GetChannel(), state);
+  } else if (channel->GetService() == kTwitchVODService) {
+    return CheckTwitchVOD(channel->GetChannel(), state);
+  } else if (channel->GetService() == kAngelThumpService) {
+    return CheckAngelThump(channel->GetChannel(), state);
+  } else if (channel->GetService() == kYouTubeService) {
+    return CheckYouTube(channel->GetChannel(), state);
+  }
+
+  // services without an API are left as they are
+  return Status::ERROR;
+}
+
 const Status ServicePoller::CheckAngelThump(const std::string& name,
                                             ChannelState* state) {
   angelthump::Client client;
   angelthump::ChannelResult channel;
+  angelthump_limiter_.Acquire();
   auto status = client.GetChannelByName(name, &channel);
 
   if (!status.Ok()) {
@@ -56,23 +214,20 @@ const Status ServicePoller::CheckAngelThump(const std::string& name,
   state->live = channel.GetLive();
   state->thumbnail = channel.GetThumbnail();
   state->viewers = channel.GetViewers();
+
+  return Status::OK;
 }
 
 const Status ServicePoller::CheckTwitchStream(const std::string& name,
                                               ChannelState* state) {
-  twitch::UsersResult users;
-  auto user_status = twitch_->GetUsersByName(name, &users);
+  uint64_t user_id;
+  auto user_status = GetTwitchUserID(name, &user_id);
   if (!user_status.Ok()) {
     return user_status;
   }
 
-  if (users.IsEmpty()) {
-    return Status(StatusCode::ERROR, "Invalid login: " + name,
-                  "Twitch API did not return a user matching this login");
-  }
-
-  auto user_id = users.GetUser(0).GetID();
   twitch::StreamsResult stream;
+  twitch_limiter_.Acquire();
   auto stream_status = twitch_->GetStreamByID(user_id, &stream);
   if (!stream_status.Ok()) {
     return stream_status;
@@ -84,6 +239,7 @@ const Status ServicePoller::CheckTwitchStream(const std::string& name,
     state->viewers = stream.GetViewers();
   } else {
     twitch::ChannelsResult channel;
+    twitch_limiter_.Acquire();
     auto channel_status = twitch_->GetChannelByID(user_id, &channel);
     if (!channel_status.Ok()) {
       return channel_status;
@@ -97,9 +253,109 @@ const Status ServicePoller::CheckTwitchStream(const std::string& name,
   return Status::OK;
 }
 
+const Status ServicePoller::CheckTwitchStreams(
+    const std::vector<std::string>& names,
+    std::unordered_map<std::string, ChannelState>* states) {
+  // logins differing only in case share an id
+  std::unordered_map<uint64_t, std::vector<std::string>> names_by_id;
+  std::vector<uint64_t> ids;
+  for (const auto& name : names) {
+    uint64_t user_id;
+    if (!GetTwitchUserID(name, &user_id).Ok()) {
+      continue;
+    }
+    auto& id_names = names_by_id[user_id];
+    if (id_names.empty()) {
+      ids.push_back(user_id);
+    }
+    id_names.push_back(name);
+  }
+  if (ids.empty()) {
+    return Status::OK;
+  }
+
+  twitch::LiveStreamsResult streams;
+  twitch_limiter_.Acquire();
+  auto status = twitch_->GetStreamsByIDs(ids, &streams);
+  if (!status.Ok()) {
+    return status;
+  }
+
+  for (size_t i = 0; i < streams.GetSize(); ++i) {
+    const auto stream = streams.GetStream(i);
+    auto it = names_by_id.find(stream.GetChannelID());
+    if (it == names_by_id.end()) {
+      continue;
+    }
+
+    ChannelState state;
+    state.live = true;
+    state.thumbnail = stream.GetLargePreview();
+    state.viewers = stream.GetViewers();
+    for (const auto& name : it->second) {
+      (*states)[name] = state;
+    }
+    names_by_id.erase(it);
+  }
+
+  // channels missing from the results are offline and show their banner
+  for (const auto& i : names_by_id) {
+    twitch::ChannelsResult channel;
+    twitch_limiter_.Acquire();
+    auto channel_status = twitch_->GetChannelByID(i.first, &channel);
+    if (!channel_status.Ok()) {
+      status = channel_status;
+      continue;
+    }
+
+    ChannelState state;
+    state.live = false;
+    state.thumbnail = channel.GetVideoBanner();
+    state.viewers = 0;
+    for (const auto& name : i.second) {
+      (*states)[name] = state;
+    }
+  }
+
+  return status;
+}
+
+const Status ServicePoller::GetTwitchUserID(const std::string& name,
+                                            uint64_t* id) {
+  auto user_ids = db_->GetTwitchUserIDs();
+  switch (user_ids->Get(name, id)) {
+    case TwitchUserIDs::FOUND:
+      return Status::OK;
+    case TwitchUserIDs::NOT_FOUND:
+      return Status(StatusCode::ERROR, "Invalid login: " + name,
+                    "Twitch API did not return a user matching this login");
+    case TwitchUserIDs::MISS:
+      break;
+  }
+
+  twitch::UsersResult users;
+  twitch_limiter_.Acquire();
+  auto status = twitch_->GetUsersByName(name, &users);
+  if (!status.Ok()) {
+    // failed requests say nothing about the login so aren't cached
+    return status;
+  }
+
+  if (users.IsEmpty()) {
+    user_ids->Set(name, 0);
+    return Status(StatusCode::ERROR, "Invalid login: " + name,
+                  "Twitch API did not return a user matching this login");
+  }
+
+  *id = users.GetUser(0).GetID();
+  user_ids->Set(name, *id);
+  return Status::OK;
+}
+
 const Status ServicePoller::CheckTwitchVOD(const std::string& name,
                                            ChannelState* state) {
   twitch::VideosResult videos;
+  twitch_limiter_.Acquire();
   auto status = twitch_->GetVideosByID("v" + name, &videos);
 
   if (status.Ok()) {
@@ -113,17 +369,45 @@ const Status ServicePoller::CheckTwitchVOD(const std::string& name,
 
 const Status ServicePoller::CheckYouTube(const std::string& name,
                                          ChannelState* state) {
-  youtube::VideosResult videos;
-  auto status = youtube_->GetVideosByID(name, &videos);
+  std::unordered_map<std::string, ChannelState> states;
+  auto status = CheckYouTubeVideos({name}, &states);
 
-  if (status.Ok() && !videos.IsEmpty()) {
-    auto video = videos.GetVideo(0);
-    state->live = true;
-    state->thumbnail = video.GetMediumThumbnail();
-    state->viewers = video.GetViewers();
+  if (status.Ok()) {
+    *state = states[name];
   }
 
   return status;
 }
 
+const Status ServicePoller::CheckYouTubeVideos(
+    const std::vector<std::string>& names,
+    std::unordered_map<std::string, ChannelState>* states) {
+  youtube::VideosResult videos;
+  youtube_limiter_.Acquire();
+  auto status = youtube_->GetVideosByIDs(names, &videos);
+  if (!status.Ok()) {
+    return status;
+  }
+
+  // videos that no longer exist are reported as offline
+  for (const auto& name : names) {
+    (*states)[name] = ChannelState();
+  }
+
+  for (size_t i = 0; i < videos.GetSize(); ++i) {
+    const auto video = videos.GetVideo(i);
+    auto it = states->find(video.GetID());
+    if (it == states->end()) {
+      continue;
+    }
+
+    auto& state = it->second;
+    state.live = video.IsLive();
+    state.thumbnail = video.GetMediumThumbnail();
+    state.viewers = state.live ? video.GetViewers() : 0;
+  }
+
+  return Status::OK;
+}
+
 }  // namespace rustla2
@@ -1,12 +1,19 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "APIClient.h"
 #include "DB.h"
+#include "PollSchedule.h"
+#include "RateLimiter.h"
 #include "Status.h"
 #include "TwitchClient.h"
+#include "WorkerPool.h"
 #include "YoutubeClient.h"
 
 namespace rustla2 {
@@ -23,8 +30,26 @@ class ServicePoller {
  public:
   explicit ServicePoller(std::shared_ptr<DB> db);
 
+  /**
+   * Check the streams with rustlers that the schedule says are due, up to
+   * the configured number of requests at once, and save any changes. Twitch
+   * and YouTube streams are checked a page at a time. Returns once every
+   * check has finished.
+   */
   void Run();
 
+  /**
+   * Call Run whenever streams come due, logging the poll and upstream
+   * connection totals every few minutes. Never returns.
+   */
+  void Loop();
+
+  // Totals since startup of polls that changed a stream and of those that
+  // found it as it was.
+  uint64_t GetSavedCount() const { return saved_count_; }
+
+  uint64_t GetSkippedCount() const { return skipped_count_; }
+
   const Status CheckAngelThump(const std::string& name, ChannelState* state);
 
   const Status CheckTwitchStream(const std::string& name, ChannelState* state);
@@ -33,10 +58,34 @@ class ServicePoller {
 
   const Status CheckYouTube(const std::string& name, ChannelState* state);
 
+  // Batched versions of the above for up to a page of channels. Channels
+  // whose state couldn't be determined are left out of |states|.
+  const Status CheckTwitchStreams(
+      const std::vector<std::string>& names,
+      std::unordered_map<std::string, ChannelState>* states);
+
+  const Status CheckYouTubeVideos(
+      const std::vector<std::string>& names,
+      std::unordered_map<std::string, ChannelState>* states);
+
  private:
+  const Status CheckStream(Stream* stream, ChannelState* state);
+
+  // Resolve a Twitch login to its user id, from the cache if possible.
+  const Status GetTwitchUserID(const std::string& name, uint64_t* id);
+
   std::shared_ptr<DB> db_;
+  // requests are almost all time spent waiting on the network, so checks
+  // run on more threads than there are cores
+  WorkerPool workers_;
+  PollSchedule schedule_;
+  RateLimiter twitch_limiter_;
+  RateLimiter youtube_limiter_;
+  RateLimiter angelthump_limiter_;
   std::unique_ptr<twitch::Client> twitch_;
   std::unique_ptr<youtube::Client> youtube_;
+  std::atomic<uint64_t> saved_count_{0};
+  std::atomic<uint64_t> skipped_count_{0};
 };
 
 }  // namespace rustla2
@@ -0,0 +1,181 @@
+#include "StaticAssets.h"
+
+#include <folly/String.h>
+#include <glog/logging.h>
+#include <openssl/sha.h>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+
+#include "HTTPResponseWriter.h"
+
+namespace rustla2 {
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Strong validator derived from the file contents so it survives restarts
+// and only changes when the file does.
+std::string GetContentETag(const std::string& body) {
+  unsigned char digest[SHA_DIGEST_LENGTH];
+  SHA1(reinterpret_cast<const unsigned char*>(body.data()), body.size(),
+       digest);
+
+  std::string hex;
+  folly::hexlify(folly::ByteRange(digest, sizeof(digest)), hex);
+  return "\"" + hex + "\"";
+}
+
+}  // namespace
+
+std::shared_ptr<const StaticAsset> StaticAsset::Load(const fs::path& path,
+                                                     MIMETypes* mime_types) {
+  const auto abs_path = fs::absolute(path).string();
+
+  // taken before reading so a write racing the read leaves a newer mtime on
+  // the file and is picked up by the next reload
+  struct stat st;
+  if (stat(abs_path.c_str(), &st) != 0) {
+    LOG(ERROR) << "failed to stat static asset " << abs_path;
+    return nullptr;
+  }
+
+  std::ifstream file(abs_path, std::ios::binary);
+  if (!file) {
+    LOG(ERROR) << "failed to read static asset " << abs_path;
+    return nullptr;
+  }
+  const std::string body((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+
+  auto asset = std::make_shared<StaticAsset>();
+  asset->content_type_ = mime_types->Get(abs_path);
+  asset->last_modified_ = st.st_mtim.tv_sec;
+  asset->mtime_ = st.st_mtim;
+  std::tm mtime_tm;
+  gmtime_r(&asset->last_modified_, &mtime_tm);
+
+  auto render = [&](StaticAssetVariant* variant, folly::StringPiece data,
+                    const char* content_encoding) {
+    auto write_headers = [&](HTTPResponseWriter* writer) {
+      writer->Header("Cache-Control", kStaticAssetCacheControl);
+      writer->Header("ETag", variant->etag);
+      writer->Header("Last-Modified", &mtime_tm);
+      writer->Header("Vary", "Accept-Encoding");
+    };
+
+    HTTPResponseWriter writer(&variant->response);
+    writer.Status(200, "OK");
+    write_headers(&writer);
+    writer.Header("Content-Type", asset->content_type_);
+    writer.Header("Accept-Ranges", "bytes");
+    if (content_encoding != nullptr) {
+      writer.Header("Content-Encoding", content_encoding);
+    }
+    writer.UncompressedBody(data.data(), data.size());
+    variant->header_size = variant->response.size() - data.size();
+
+    HTTPResponseWriter not_modified_writer(&variant->not_modified);
+    not_modified_writer.Status(304, "Not Modified");
+    write_headers(&not_modified_writer);
+    not_modified_writer.EndHeaders();
+  };
+
+  const auto etag = GetContentETag(body);
+  asset->identity_.etag = etag;
+  render(&asset->identity_, body, nullptr);
+
+  // assets are loaded once so spend the time on smaller responses
+  std::string compressed;
+  if (Compress(ContentEncoding::GZIP, body.data(), body.size(), &compressed,
+               Z_BEST_COMPRESSION) &&
+      compressed.size() < body.size()) {
+    // each representation needs its own strong validator
+    asset->gzip_.etag = etag.substr(0, etag.size() - 1) + "-gzip\"";
+    render(&asset->gzip_, compressed, "gzip");
+  }
+
+  return asset;
+}
+
+bool StaticAsset::IsCurrent(const fs::path& path) const {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return false;
+  }
+  return st.st_mtim.tv_sec == mtime_.tv_sec &&
+         st.st_mtim.tv_nsec == mtime_.tv_nsec &&
+         static_cast<size_t>(st.st_size) == GetSize();
+}
+
+StaticAssets::StaticAssets(const std::string& root_dir,
+                           const StaticAssets* previous,
+                           const std::string& index) {
+  MIMETypes mime_types;
+
+  for (fs::recursive_directory_iterator
+           i = fs::recursive_directory_iterator(fs::path(root_dir)),
+           end_iter;
+       i != end_iter; i++) {
+    auto path = i->path();
+    if (fs::is_regular_file(path)) {
+      folly::StringPiece server_path(path.string());
+      server_path.removePrefix(root_dir);
+      server_path.removeSuffix(index);
+
+      auto key = server_path.toString();
+
+      std::shared_ptr<const StaticAsset> asset;
+      if (previous != nullptr) {
+        auto prev = previous->Get(key);
+        if (prev != nullptr && prev->IsCurrent(path)) {
+          asset = prev;
+        }
+      }
+      if (asset == nullptr) {
+        asset = StaticAsset::Load(path, &mime_types);
+      }
+
+      if (asset == nullptr) {
+        continue;
+      }
+      auto it = assets_.find(key);
+      if (it == assets_.end()) {
+        paths_.emplace_back(new std::string(key));
+        assets_.emplace(folly::StringPiece(*paths_.back()), asset);
+      } else {
+        it->second = asset;
+      }
+    }
+  }
+}
+
+std::shared_ptr<const StaticAsset> StaticAssets::Get(
+    folly::StringPiece path) const {
+  auto it = assets_.find(path);
+  return it == assets_.end() ? nullptr : it->second;
+}
+
+StaticAssetStore::StaticAssetStore(const std::string& root_dir)
+    : root_dir_(root_dir), assets_(new StaticAssets(root_dir)) {}
+
+void StaticAssetStore::Reload() {
+  const auto start = std::chrono::steady_clock::now();
+
+  auto previous = Get();
+  std::shared_ptr<const StaticAssets> assets(
+      new StaticAssets(root_dir_, previous.get()));
+  std::atomic_store(&assets_, assets);
+
+  LOG(INFO) << "reloaded " << assets->GetSize() << " static assets in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start)
+                   .count()
+            << "ms";
+}
+
+}  // namespace rustla2
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <folly/Range.h>
+#include <boost/filesystem/path.hpp>
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Compression.h"
+#include "MIMETypes.h"
+
+namespace rustla2 {
+
+constexpr char kStaticAssetCacheControl[] = "max-age=3600, public";
+
+/**
+ * One encoding of an asset, rendered as complete 200 and 304 responses so
+ * they can be written to the socket as is.
+ */
+struct StaticAssetVariant {
+  const char* Data() const { return response.data(); }
+
+  size_t Size() const { return response.size(); }
+
+  size_t HeaderSize() const { return header_size; }
+
+  folly::StringPiece Body() const {
+    return folly::StringPiece(response).subpiece(header_size);
+  }
+
+  std::string response;
+  size_t header_size{0};
+  std::string etag;
+  std::string not_modified;
+};
+
+class StaticAsset {
+ public:
+  /**
+   * Read and render the file at |path|. Returns nullptr if it can't be read.
+   */
+  static std::shared_ptr<const StaticAsset> Load(
+      const boost::filesystem::path& path, MIMETypes* mime_types);
+
+  /**
+   * Return the variant to send to a client that negotiated |encoding|.
+   */
+  const StaticAssetVariant& Select(const ContentEncoding encoding) const {
+    return encoding == ContentEncoding::GZIP && !gzip_.response.empty()
+               ? gzip_
+               : identity_;
+  }
+
+  // Byte ranges are served from the uncompressed file.
+  const StaticAssetVariant& GetIdentity() const { return identity_; }
+
+  const std::string& GetContentType() const { return content_type_; }
+
+  time_t GetLastModified() const { return last_modified_; }
+
+  /**
+   * Whether the file at |path| has the size and nanosecond modification time
+   * this asset was loaded with, so a file rewritten within the same second is
+   * still seen to have changed.
+   */
+  bool IsCurrent(const boost::filesystem::path& path) const;
+
+  size_t GetSize() const { return identity_.Body().size(); }
+
+ private:
+  std::string content_type_;
+  time_t last_modified_{0};
+  struct timespec mtime_{};
+  StaticAssetVariant identity_;
+  // left empty if compressing the file didn't make it smaller
+  StaticAssetVariant gzip_;
+};
+
+/**
+ * Read only snapshot of the files under the public directory. Shared by every
+ * hub so each asset is held in memory once per process rather than once per
+ * thread.
+ */
+class StaticAssets {
+ public:
+  /**
+   * Files whose size and modification time match their entry in |previous|
+   * reuse it instead of being read and compressed again.
+   */
+  explicit StaticAssets(const std::string& root_dir,
+                        const StaticAssets* previous = nullptr,
+                        const std::string& index = "index.html");
+
+  // Looks |path| up in place so serving an asset doesn't allocate.
+  std::shared_ptr<const StaticAsset> Get(folly::StringPiece path) const;
+
+  size_t GetSize() const { return assets_.size(); }
+
+ private:
+  struct PathHash {
+    size_t operator()(folly::StringPiece path) const { return path.hash(); }
+  };
+
+  // keys point into paths owned by the snapshot
+  std::vector<std::unique_ptr<std::string>> paths_;
+  std::unordered_map<folly::StringPiece, std::shared_ptr<const StaticAsset>,
+                     PathHash>
+      assets_;
+};
+
+/**
+ * Holds the current StaticAssets snapshot. Reloads build a new snapshot on
+ * the calling thread and swap it in atomically, so hubs keep serving the old
+ * one until the new one is complete and requests already holding it finish
+ * undisturbed.
+ */
+class StaticAssetStore {
+ public:
+  explicit StaticAssetStore(const std::string& root_dir);
+
+  std::shared_ptr<const StaticAssets> Get() const {
+    return std::atomic_load(&assets_);
+  }
+
+  void Reload();
+
+ private:
+  const std::string root_dir_;
+  std::shared_ptr<const StaticAssets> assets_;
+};
+
+}  // namespace rustla2
@@ -1,65 +1,182 @@
 #include "StaticHTTPService.h"
 
+#include <folly/Conv.h>
+#include <folly/Format.h>
 #include <folly/String.h>
 #include <uWS/uWS.h>
-#include <boost/filesystem.hpp>
-#include <boost/filesystem/path.hpp>
-#include <sstream>
+#include <algorithm>
+#include <ctime>
+#include <string>
 
-#include "HTTPRequest.h"
 #include "HTTPResponseWriter.h"
 
 namespace rustla2 {
 
-StaticCacheEntry::StaticCacheEntry(const fs::path& path) {
-  std::stringstream buf;
-  HTTPResponseWriter writer(buf);
-  writer.Status(200, "OK");
-  writer.Header("Cache-Control", "max-age=3600, public");
-  writer.LocalFile(path);
+namespace {
 
-  data_ = buf.str();
-  data_size_ = data_.size();
-
-  const std::string header_delimiter = "\r\n\r\n";
-  header_size_ = data_.find(header_delimiter) + header_delimiter.size();
+// Parse an IMF-fixdate (RFC 7231 section 7.1.1.1). Returns -1 if |date| is
+// malformed.
+time_t ParseHTTPDate(folly::StringPiece date) {
+  const auto value = date.str();
+  std::tm tm = {};
+  const char* end = strptime(value.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+  if (end == nullptr || *end != '\0') {
+    return -1;
+  }
+  return timegm(&tm);
 }
 
-StaticHTTPService::StaticHTTPService(const std::string& root_dir,
-                                     const std::string& index) {
-  for (fs::recursive_directory_iterator
-           i = fs::recursive_directory_iterator(fs::path(root_dir)),
-           end_iter;
-       i != end_iter; i++) {
-    auto path = i->path();
-    if (fs::is_regular_file(path)) {
-      folly::StringPiece server_path(path.string());
-      server_path.removePrefix(root_dir);
-      server_path.removeSuffix(index);
-
-      cache_[server_path.toString()].reset(new StaticCacheEntry(path));
+enum class RangeResult { NONE, SATISFIABLE, UNSATISFIABLE };
+
+// Parse a single `bytes=` range against a file of |size| bytes into the
+// inclusive interval [|first|, |last|]. Multiple ranges and anything
+// malformed are ignored so the client gets the whole file (RFC 7233
+// section 3.1).
+RangeResult ParseRange(folly::StringPiece range, const size_t size,
+                       size_t* first, size_t* last) {
+  if (!range.removePrefix("bytes=") ||
+      range.find(',') != folly::StringPiece::npos) {
+    return RangeResult::NONE;
+  }
+  range = folly::trimWhitespace(range);
+
+  const auto dash = range.find('-');
+  if (dash == folly::StringPiece::npos) {
+    return RangeResult::NONE;
+  }
+  const auto first_str = range.subpiece(0, dash);
+  const auto last_str = range.subpiece(dash + 1);
+
+  if (first_str.empty()) {
+    // suffix range: the final n bytes
+    const auto suffix = folly::tryTo<size_t>(last_str);
+    if (!suffix.hasValue()) {
+      return RangeResult::NONE;
+    }
+    if (suffix.value() == 0 || size == 0) {
+      return RangeResult::UNSATISFIABLE;
     }
+    *first = size - std::min(suffix.value(), size);
+    *last = size - 1;
+    return RangeResult::SATISFIABLE;
   }
+
+  const auto start = folly::tryTo<size_t>(first_str);
+  if (!start.hasValue()) {
+    return RangeResult::NONE;
+  }
+  size_t end = size - 1;
+  if (!last_str.empty()) {
+    const auto parsed_end = folly::tryTo<size_t>(last_str);
+    if (!parsed_end.hasValue() || parsed_end.value() < start.value()) {
+      return RangeResult::NONE;
+    }
+    end = std::min(parsed_end.value(), end);
+  }
+  if (start.value() >= size) {
+    return RangeResult::UNSATISFIABLE;
+  }
+
+  *first = start.value();
+  *last = end;
+  return RangeResult::SATISFIABLE;
 }
 
-void StaticHTTPService::RegisterRoutes(HTTPRouter* router) {
-  for (const auto& i : cache_) {
-    const auto cache = i.second;
-    router->Get(i.first, [=](uWS::HttpResponse* res, HTTPRequest* req) {
-      res->write(cache->Data(), cache->Size());
-      res->end();
-    });
-
-    router->Head(i.first, [=](uWS::HttpResponse* res, HTTPRequest* req) {
-      res->write(cache->Data(), cache->HeaderSize());
-      res->end();
-    });
+// Whether an If-Modified-Since validator shows the client's copy is current.
+// Only consulted when If-None-Match is absent (RFC 7232 section 6).
+bool IsNotModifiedSince(folly::StringPiece if_modified_since,
+                        const time_t last_modified) {
+  if (if_modified_since.empty()) {
+    return false;
   }
+  const auto since = ParseHTTPDate(if_modified_since);
+  return since != -1 && last_modified <= since;
 }
 
-void StaticHTTPService::ServeIndex(uWS::HttpResponse* res) {
-  const auto& cache = cache_["/"];
-  res->write(cache->Data(), cache->Size());
+}  // namespace
+
+void StaticHTTPService::Serve(uWS::HttpResponse* res, HTTPRequest* req) {
+  // looked up per request rather than registered as routes so files added by
+  // a reload are served without rebuilding every hub's router
+  const auto assets = store_->Get();
+  const auto method = req->GetMethod();
+  const bool head = method == uWS::HttpMethod::METHOD_HEAD;
+
+  std::shared_ptr<const StaticAsset> asset;
+  if (head || method == uWS::HttpMethod::METHOD_GET) {
+    asset = assets->Get(req->GetPathString());
+  }
+  if (asset == nullptr) {
+    // unknown paths get the client side app, which does its own routing
+    asset = assets->Get("/");
+  }
+  if (asset == nullptr) {
+    HTTPResponseWriter writer(res, req->GetResponseOptions());
+    writer.Status(404, "Not Found");
+    writer.Body();
+    return;
+  }
+
+  Serve(*asset, res, req, head);
+}
+
+void StaticHTTPService::Serve(const StaticAsset& asset, uWS::HttpResponse* res,
+                              HTTPRequest* req, const bool head) {
+  const auto& variant = asset.Select(req->GetAcceptedEncoding());
+
+  const bool has_if_none_match = !req->GetHeader("if-none-match").empty();
+  if (has_if_none_match
+          ? req->MatchesIfNoneMatch(variant.etag)
+          : IsNotModifiedSince(req->GetHeader("if-modified-since"),
+                               asset.GetLastModified())) {
+    res->write(variant.not_modified.data(), variant.not_modified.size());
+    res->end();
+    return;
+  }
+
+  const auto range = req->GetHeader("range");
+  if (!head && !range.empty()) {
+    // ranges are byte offsets into the identity encoding, and only apply if
+    // the client's partial copy is still the current version
+    const auto& identity = asset.GetIdentity();
+    const auto if_range = req->GetHeader("if-range");
+    if (if_range.empty() || if_range == identity.etag) {
+      const auto body = identity.Body();
+      size_t first = 0;
+      size_t last = 0;
+      switch (ParseRange(range, body.size(), &first, &last)) {
+        case RangeResult::SATISFIABLE: {
+          std::tm last_modified_tm;
+          const auto last_modified = asset.GetLastModified();
+          gmtime_r(&last_modified, &last_modified_tm);
+
+          HTTPResponseWriter writer(res, req->GetResponseOptions());
+          writer.Status(206, "Partial Content");
+          writer.Header("Cache-Control", kStaticAssetCacheControl);
+          writer.Header("Content-Range", folly::sformat("bytes {}-{}/{}", first,
+                                                        last, body.size()));
+          writer.Header("Content-Type", asset.GetContentType());
+          writer.Header("ETag", identity.etag);
+          writer.Header("Last-Modified", &last_modified_tm);
+          writer.Header("Vary", "Accept-Encoding");
+          writer.UncompressedBody(body.data() + first, last - first + 1);
+          return;
+        }
+        case RangeResult::UNSATISFIABLE: {
+          HTTPResponseWriter writer(res, req->GetResponseOptions());
+          writer.Status(416, "Range Not Satisfiable");
+          writer.Header("Content-Range",
+                        folly::sformat("bytes */{}", body.size()));
+          writer.UncompressedBody(nullptr, 0);
+          return;
+        }
+        case RangeResult::NONE:
+          break;
+      }
+    }
+  }
+
+  res->write(variant.Data(), head ? variant.HeaderSize() : variant.Size());
   res->end();
 }
 
@@ -1,43 +1,32 @@
 #pragma once
 
-#include <boost/filesystem/path.hpp>
 #include <memory>
-#include <string>
-#include <unordered_map>
 
-#include "HTTPRouter.h"
+#include "HTTPRequest.h"
+#include "StaticAssets.h"
 
 namespace rustla2 {
 
-namespace fs = boost::filesystem;
-
-class StaticCacheEntry {
- public:
-  explicit StaticCacheEntry(const fs::path& path);
-
-  const char* Data() { return data_.c_str(); }
-
-  const size_t Size() { return data_size_; }
-
-  const size_t HeaderSize() { return header_size_; }
-
- private:
-  std::string data_;
-  size_t data_size_;
-  size_t header_size_;
-};
-
 class StaticHTTPService {
  public:
-  explicit StaticHTTPService(const std::string& root_dir,
-                             const std::string& index = "index.html");
-
-  void RegisterRoutes(HTTPRouter* router);
+  explicit StaticHTTPService(std::shared_ptr<StaticAssetStore> store)
+      : store_(store) {}
 
-  void ServeIndex(uWS::HttpResponse* res);
+  /**
+   * Serve the file at the request path from the current snapshot, or the
+   * index for paths that don't name a file.
+   */
+  void Serve(uWS::HttpResponse* res, HTTPRequest* req);
 
  private:
-  std::unordered_map<std::string, std::shared_ptr<StaticCacheEntry>> cache_;
+  /**
+   * Write |asset| honouring conditional and range request headers. HEAD
+   * requests get the headers of the full response.
+   */
+  void Serve(const StaticAsset& asset, uWS::HttpResponse* res,
+             HTTPRequest* req, const bool head);
+
+  std::shared_ptr<StaticAssetStore> store_;
 };
 
 }  // namespace rustla2
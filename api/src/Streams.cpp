@@ -1,7 +1,5 @@
 #include "Streams.h"
 
-#include <algorithm>
-
 namespace rustla2 {
 
 void Stream::WriteAPIJSON(rapidjson::Writer<rapidjson::StringBuffer> *writer) {
@@ -52,27 +50,78 @@ void Stream::WriteJSON(rapidjson::Writer<rapidjson::StringBuffer> *writer) {
 }
 
 bool Stream::Save() {
+  if (dirty_ == 0) {
+    return false;
+  }
+
+  auto self = shared_from_this();
+  writer_->Enqueue(
+      this, [self]() { return self->WriteUpdate(); }, false,
+      [self]() { self->dirty_ |= self->uncommitted_.exchange(0); });
+  return true;
+}
+
+void Stream::SaveNew() {
+  auto self = shared_from_this();
+  writer_->Enqueue(this, [self]() { return self->WriteInsert(); }, true);
+}
+
+bool Stream::WriteUpdate() {
   boost::shared_lock<boost::shared_mutex> read_lock(lock_);
+  const uint32_t columns = dirty_.exchange(0);
+  uncommitted_ = columns;
+  if (columns == 0) {
+    // written by an earlier update or the insert
+    return true;
+  }
+
+  std::string sql = "UPDATE `streams` SET ";
+  if (columns & CHANNEL) {
+    sql += "`channel` = ?, `service` = ?, ";
+  }
+  if (columns & IS_NSFW) {
+    sql += "`is_nsfw` = ?, ";
+  }
+  if (columns & IS_BANNED) {
+    sql += "`is_banned` = ?, ";
+  }
+  if (columns & THUMBNAIL) {
+    sql += "`thumbnail` = ?, ";
+  }
+  if (columns & IS_LIVE) {
+    sql += "`is_live` = ?, ";
+  }
+  if (columns & VIEWERS) {
+    sql += "`viewers` = ?, ";
+  }
+  sql += "`updated_at` = datetime() WHERE `id` = ?";
+
   try {
-    const auto sql = R"sql(
-        UPDATE `streams` SET
-          `channel` = ?,
-          `service` = ?,
-          `overrustle_id` = ?,
-          `is_nsfw` = ?,
-          `is_banned` = ?,
-          `thumbnail` = ?,
-          `is_live` = ?,
-          `viewers` = ?,
-          `updated_at` = datetime()
-        WHERE `id` = ?
-      )sql";
-    db_ << sql << channel_->GetChannel() << channel_->GetService()
-        << overrustle_id_ << is_nsfw_ << is_banned_ << thumbnail_ << is_live_
-        << viewer_count_ << id_;
+    auto query = statements_->Get(sql);
+    if (columns & CHANNEL) {
+      query << channel_->GetChannel() << channel_->GetService();
+    }
+    if (columns & IS_NSFW) {
+      query << is_nsfw_;
+    }
+    if (columns & IS_BANNED) {
+      query << is_banned_;
+    }
+    if (columns & THUMBNAIL) {
+      query << thumbnail_;
+    }
+    if (columns & IS_LIVE) {
+      query << is_live_;
+    }
+    if (columns & VIEWERS) {
+      query << viewer_count_;
+    }
+    query << id_;
+    query.Execute();
   } catch (const sqlite::sqlite_exception &e) {
     LOG(ERROR) << "error updating stream "
                << "id " << id_ << ", "
+               << "columns " << columns << ", "
                << "channel " << channel_->GetChannel() << ", "
                << "service " << channel_->GetService() << ", "
                << "overrustle_id " << overrustle_id_ << ", "
@@ -83,14 +132,17 @@ bool Stream::Save() {
                << "error: " << e.what() << ", "
                << "code: " << e.get_extended_code();
 
+    // retried with the next change
+    dirty_ |= columns;
     return false;
   }
 
   return true;
 }
 
-bool Stream::SaveNew() {
+bool Stream::WriteInsert() {
   boost::shared_lock<boost::shared_mutex> read_lock(lock_);
+  dirty_ = 0;
   try {
     const auto sql = R"sql(
         INSERT INTO `streams` (
@@ -120,9 +172,11 @@ bool Stream::SaveNew() {
           datetime()
         )
       )sql";
-    db_ << sql << id_ << channel_->GetChannel() << channel_->GetService()
-        << overrustle_id_ << is_nsfw_ << is_banned_ << thumbnail_ << is_live_
-        << viewer_count_;
+    auto query = statements_->Get(sql);
+    query << id_ << channel_->GetChannel() << channel_->GetService()
+          << overrustle_id_ << is_nsfw_ << is_banned_ << thumbnail_ << is_live_
+          << viewer_count_;
+    query.Execute();
   } catch (const sqlite::sqlite_exception &e) {
     LOG(ERROR) << "error creating stream "
                << "id " << id_ << ", "
@@ -143,7 +197,13 @@ bool Stream::SaveNew() {
   return true;
 }
 
-Streams::Streams(sqlite::database db) : db_(db) {
+Streams::Streams(sqlite::database db, sqlite::database reader,
+                 std::shared_ptr<PreparedStatements> statements,
+                 std::shared_ptr<DBWriter> writer)
+    : db_(db),
+      statements_(statements),
+      writer_(writer),
+      updates_(std::make_shared<StreamUpdateQueue>()) {
   InitTable();
 
   auto sql = R"sql(
@@ -159,7 +219,7 @@ Streams::Streams(sqlite::database db) : db_(db) {
         `viewers`
       FROM `streams`
     )sql";
-  auto query = db_ << sql;
+  auto query = reader << sql;
 
   query >> [&](const uint64_t id, const std::string &channel,
                const std::string &service, const std::string &overrustle_id,
@@ -167,9 +227,9 @@ Streams::Streams(sqlite::database db) : db_(db) {
                const std::string &thumbnail, const bool live,
                const uint64_t viewer_count) {
     const auto stream_channel = Channel::Create(channel, service);
-    auto stream = std::make_shared<Stream>(db_, id, stream_channel,
-                                           overrustle_id, is_nsfw, is_banned,
-                                           thumbnail, live, viewer_count);
+    auto stream = std::make_shared<Stream>(
+        statements_, writer_, updates_, id, stream_channel, overrustle_id,
+        is_nsfw, is_banned, thumbnail, live, viewer_count);
 
     data_by_id_[stream->GetID()] = stream;
     data_by_channel_[stream_channel] = stream;
@@ -200,25 +260,70 @@ void Streams::InitTable() {
   db_ << sql;
 }
 
-std::vector<std::shared_ptr<Stream>> Streams::GetAllUpdatedSince(
-    uint64_t timestamp) {
+/**
+ * Return the streams whose rustler counts changed since the previous call.
+ * Broadcast loops only touch streams that changed rather than scanning and
+ * sorting the whole table.
+ */
+std::vector<std::shared_ptr<Stream>> Streams::TakeUpdated() {
   std::vector<std::shared_ptr<Stream>> streams;
 
-  boost::shared_lock<boost::shared_mutex> read_lock(lock_);
-  for (const auto i : data_by_id_) {
-    if (i.second->GetUpdateTime() >= timestamp) {
-      streams.push_back(i.second);
-    }
-  }
+  boost::unique_lock<boost::shared_mutex> write_lock(lock_);
+  SyncRanking();
+  streams.swap(untaken_);
+  untaken_ids_.clear();
 
   return streams;
 }
 
+/**
+ * Move the streams whose rustler counts changed to their new positions in the
+ * ranking and hold them for the next TakeUpdated. Rustler joins and leaves
+ * only queue the stream, so they never wait on |lock_|; readers of the
+ * ranking call this first so it's current whether or not TakeUpdated is
+ * being called.
+ */
+void Streams::SyncRanking() {
+  for (const auto id : updates_->Drain()) {
+    auto it = data_by_id_.find(id);
+    if (it == data_by_id_.end()) {
+      continue;
+    }
+
+    const auto &stream = it->second;
+    stream->ClearUpdated();
+    const auto rustler_count = stream->GetRustlerCount();
+
+    if (untaken_ids_.insert(id).second) {
+      untaken_.push_back(stream);
+    }
+
+    auto ranked = ranked_counts_.find(id);
+    if (ranked != ranked_counts_.end()) {
+      if (ranked->second == rustler_count) {
+        continue;
+      }
+      ranking_.erase(RankingKey(ranked->second, id));
+      ranked_counts_.erase(ranked);
+    }
+
+    if (rustler_count > 0) {
+      ranking_.emplace(RankingKey(rustler_count, id), stream);
+      ranked_counts_.emplace(id, rustler_count);
+    }
+  }
+}
+
+/**
+ * Return the streams with rustlers ordered by their rustler counts.
+ */
 std::vector<std::shared_ptr<Stream>> Streams::GetAllWithRustlers() {
   std::vector<std::shared_ptr<Stream>> streams;
 
-  boost::shared_lock<boost::shared_mutex> read_lock(lock_);
-  for (const auto i : data_by_id_) {
+  boost::unique_lock<boost::shared_mutex> write_lock(lock_);
+  SyncRanking();
+  streams.reserve(ranking_.size());
+  for (const auto &i : ranking_) {
     if (i.second->GetRustlerCount() > 0) {
       streams.push_back(i.second);
     }
@@ -227,15 +332,12 @@ std::vector<std::shared_ptr<Stream>> Streams::GetAllWithRustlers() {
   return streams;
 }
 
+/**
+ * The ranking is kept ordered as counts change so this is a walk of the index
+ * rather than a sort.
+ */
 std::vector<std::shared_ptr<Stream>> Streams::GetAllWithRustlersSorted() {
-  auto streams = GetAllWithRustlers();
-
-  std::sort(streams.begin(), streams.end(),
-            [](std::shared_ptr<Stream> a, std::shared_ptr<Stream> b) {
-              return b->GetRustlerCount() < a->GetRustlerCount();
-            });
-
-  return streams;
+  return GetAllWithRustlers();
 }
 
 void Streams::WriteJSON(rapidjson::Writer<rapidjson::StringBuffer> *writer) {
@@ -249,8 +351,11 @@ void Streams::WriteJSON(rapidjson::Writer<rapidjson::StringBuffer> *writer) {
 }
 
 std::string Streams::GetAPIJSON() {
-  auto streams = GetAllWithRustlersSorted();
+  return GetAPIJSON(GetAllWithRustlersSorted());
+}
 
+std::string Streams::GetAPIJSON(
+    const std::vector<std::shared_ptr<Stream>> &streams) {
   rapidjson::StringBuffer buf;
   rapidjson::Writer<rapidjson::StringBuffer> writer(buf);
   writer.StartObject();
@@ -288,7 +393,8 @@ void Streams::WriteStreamsJSON(
 
 std::shared_ptr<Stream> Streams::Emplace(const Channel &channel,
                                          const std::string &overrustle_id) {
-  auto stream = std::make_shared<Stream>(db_, channel, overrustle_id);
+  auto stream = std::make_shared<Stream>(statements_, writer_, updates_,
+                                         channel, overrustle_id);
 
   {
     boost::unique_lock<boost::shared_mutex> write_lock(lock_);
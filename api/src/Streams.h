@@ -4,26 +4,62 @@
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <sqlite_modern_cpp.h>
+#include <atomic>
 #include <boost/thread/shared_mutex.hpp>
 #include <chrono>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "Channel.h"
+#include "DBWriter.h"
+#include "PreparedStatements.h"
 #include "JSON.h"
 #include "Status.h"
 
 namespace rustla2 {
 
-class Stream {
+/**
+ * Ids of streams whose rustler counts changed since the queue was last
+ * drained. Each stream appears at most once between drains.
+ */
+class StreamUpdateQueue {
  public:
-  Stream(sqlite::database db, const uint64_t id, const Channel &channel,
-         const std::string &overrustle_id, const bool is_nsfw,
-         const bool is_banned, const std::string &thumbnail = "",
+  void Push(const uint64_t id) {
+    std::lock_guard<std::mutex> lock(lock_);
+    ids_.push_back(id);
+  }
+
+  std::vector<uint64_t> Drain() {
+    std::vector<uint64_t> ids;
+    std::lock_guard<std::mutex> lock(lock_);
+    ids.swap(ids_);
+    return ids;
+  }
+
+ private:
+  std::mutex lock_;
+  std::vector<uint64_t> ids_;
+};
+
+class Stream : public std::enable_shared_from_this<Stream> {
+ public:
+  Stream(std::shared_ptr<PreparedStatements> statements,
+         std::shared_ptr<DBWriter> writer,
+         std::shared_ptr<StreamUpdateQueue> updates, const uint64_t id,
+         const Channel &channel, const std::string &overrustle_id,
+         const bool is_nsfw, const bool is_banned,
+         const std::string &thumbnail = "",
          const bool is_live = false, const uint64_t viewer_count = 0)
-      : db_(db),
+      : statements_(statements),
+        writer_(writer),
+        updates_(updates),
         id_(id),
         channel_(std::shared_ptr<Channel>(channel)),
         overrustle_id_(overrustle_id),
@@ -33,17 +69,18 @@ class Stream {
         is_banned_(is_banned),
         viewer_count_(viewer_count) {}
 
-  Stream(sqlite::database db, const Channel &channel,
+  Stream(std::shared_ptr<PreparedStatements> statements,
+         std::shared_ptr<DBWriter> writer,
+         std::shared_ptr<StreamUpdateQueue> updates, const Channel &channel,
          const std::string &overrustle_id)
-      : db_(db),
+      : statements_(statements),
+        writer_(writer),
+        updates_(updates),
         id_(ChannelHash{}(channel)&json::kMaxIntSize),
         channel_(std::shared_ptr<Channel>(channel)),
         overrustle_id_(overrustle_id) {}
 
-  uint64_t GetID() {
-    boost::shared_lock<boost::shared_mutex> read_lock(lock_);
-    return id_;
-  }
+  uint64_t GetID() { return id_; }
 
   std::shared_ptr<Channel> GetChannel() {
     boost::shared_lock<boost::shared_mutex> read_lock(lock_);
@@ -80,91 +117,128 @@ class Stream {
     return viewer_count_;
   }
 
-  uint64_t GetRustlerCount() {
-    boost::shared_lock<boost::shared_mutex> read_lock(lock_);
-    return rustler_count_;
-  }
+  // Rustler counts and the reset time are atomics rather than guarded by
+  // |lock_| since every hub thread updates them on join/leave.
+  uint64_t GetRustlerCount() { return rustler_count_; }
 
-  uint64_t GetUpdateTime() {
-    boost::shared_lock<boost::shared_mutex> read_lock(lock_);
-    return update_time_;
-  }
-
-  uint64_t GetResetTime() {
-    boost::shared_lock<boost::shared_mutex> read_lock(lock_);
-    return reset_time_;
-  }
+  uint64_t GetResetTime() { return reset_time_; }
 
   void WriteAPIJSON(rapidjson::Writer<rapidjson::StringBuffer> *writer);
 
   void WriteJSON(rapidjson::Writer<rapidjson::StringBuffer> *writer);
 
   uint64_t IncrRustlerCount() {
-    boost::unique_lock<boost::shared_mutex> write_lock(lock_);
-    update_time_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                       std::chrono::steady_clock::now().time_since_epoch())
-                       .count();
+    const uint64_t rustler_count = ++rustler_count_;
 
-    if (rustler_count_ == 0) {
-      reset_time_ = update_time_;
+    if (rustler_count == 1) {
+      reset_time_ = GetSteadyTime();
     }
 
-    return ++rustler_count_;
+    MarkUpdated();
+
+    return rustler_count;
   }
 
   uint64_t DecrRustlerCount() {
-    boost::unique_lock<boost::shared_mutex> write_lock(lock_);
-
-    if (rustler_count_ == 0) {
-      LOG(WARNING) << "DecrRustlerCount called on stream with 0 rustlers";
-      return 0;
-    }
-
-    update_time_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                       std::chrono::steady_clock::now().time_since_epoch())
-                       .count();
-
-    return --rustler_count_;
+    uint64_t rustler_count = rustler_count_;
+    do {
+      if (rustler_count == 0) {
+        LOG(WARNING) << "DecrRustlerCount called on stream with 0 rustlers";
+        return 0;
+      }
+    } while (!rustler_count_.compare_exchange_weak(rustler_count,
+                                                   rustler_count - 1));
+
+    MarkUpdated();
+
+    return rustler_count - 1;
   }
 
+  // Setters only mark a column dirty if its value changes, so polls that find
+  // a stream as they left it cause no writes. They return whether it changed,
+  // which a column left dirty by an earlier, unwritten change doesn't say.
   void SetChannel(std::shared_ptr<Channel> channel) {
     boost::unique_lock<boost::shared_mutex> write_lock(lock_);
+    if (channel_->GetChannel() != channel->GetChannel() ||
+        channel_->GetService() != channel->GetService()) {
+      dirty_ |= CHANNEL;
+    }
     channel_ = channel;
   }
 
-  void SetIsLive(const bool is_live) {
-    boost::unique_lock<boost::shared_mutex> write_lock(lock_);
-    is_live_ = is_live;
+  bool SetIsLive(const bool is_live) {
+    return Set(&is_live_, is_live, IS_LIVE);
   }
 
-  void SetIsNSFW(const bool is_nsfw) {
-    boost::unique_lock<boost::shared_mutex> write_lock(lock_);
-    is_nsfw_ = is_nsfw;
+  bool SetIsNSFW(const bool is_nsfw) {
+    return Set(&is_nsfw_, is_nsfw, IS_NSFW);
   }
 
-  void SetIsBanned(const bool is_banned) {
-    boost::unique_lock<boost::shared_mutex> write_lock(lock_);
-    is_banned_ = is_banned;
+  bool SetIsBanned(const bool is_banned) {
+    return Set(&is_banned_, is_banned, IS_BANNED);
   }
 
-  void SetThumbnail(const std::string thumbnail) {
-    boost::unique_lock<boost::shared_mutex> write_lock(lock_);
-    thumbnail_ = thumbnail;
+  bool SetThumbnail(const std::string thumbnail) {
+    return Set(&thumbnail_, thumbnail, THUMBNAIL);
   }
 
-  void SetViewerCount(const uint64_t viewer_count) {
-    boost::unique_lock<boost::shared_mutex> write_lock(lock_);
-    viewer_count_ = viewer_count;
+  bool SetViewerCount(const uint64_t viewer_count) {
+    return Set(&viewer_count_, viewer_count, VIEWERS);
   }
 
+  // Queue the columns changed since the last write to be written by the
+  // DBWriter. Returns false without queueing anything if none have.
   bool Save();
 
-  bool SaveNew();
+  void SaveNew();
+
+  // Allow the next rustler count change to queue this stream again. Called by
+  // Streams before it reads the state of a drained stream.
+  void ClearUpdated() { is_updated_ = false; }
 
  private:
-  sqlite::database db_;
+  // bitmask of columns changed since the stream was last written
+  enum Column : uint32_t {
+    CHANNEL = 1 << 0,
+    IS_NSFW = 1 << 1,
+    IS_BANNED = 1 << 2,
+    THUMBNAIL = 1 << 3,
+    IS_LIVE = 1 << 4,
+    VIEWERS = 1 << 5,
+  };
+
+  template <typename T>
+  bool Set(T *field, const T &value, const Column column) {
+    boost::unique_lock<boost::shared_mutex> write_lock(lock_);
+    if (*field == value) {
+      return false;
+    }
+    *field = value;
+    dirty_ |= column;
+    return true;
+  }
+
+  bool WriteUpdate();
+
+  bool WriteInsert();
+
+  void MarkUpdated() {
+    if (updates_ != nullptr && !is_updated_.exchange(true)) {
+      updates_->Push(id_);
+    }
+  }
+
+  static uint64_t GetSteadyTime() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  std::shared_ptr<PreparedStatements> statements_;
+  std::shared_ptr<DBWriter> writer_;
+  std::shared_ptr<StreamUpdateQueue> updates_;
   boost::shared_mutex lock_;
-  uint64_t id_;
+  const uint64_t id_;
   std::shared_ptr<Channel> channel_;
   std::string overrustle_id_;
   std::string thumbnail_{""};
@@ -172,18 +246,30 @@ class Stream {
   bool is_nsfw_{false};
   bool is_banned_{false};
   uint64_t viewer_count_{0};
-  uint64_t rustler_count_{0};
-  uint64_t reset_time_{0};
-  uint64_t update_time_{0};
+  std::atomic<uint64_t> rustler_count_{0};
+  std::atomic<uint64_t> reset_time_{0};
+  std::atomic<bool> is_updated_{false};
+  // only changed by setters holding |lock_| exclusively, so writers holding
+  // it shared can swap it out without missing a change
+  std::atomic<uint32_t> dirty_{0};
+  // columns cleared from |dirty_| by a write whose batch hasn't committed, so
+  // they can be marked dirty again if it's rolled back
+  std::atomic<uint32_t> uncommitted_{0};
 };
 
 class Streams {
  public:
-  explicit Streams(sqlite::database db_);
+  // (rustler count, stream id)
+  using RankingKey = std::pair<uint64_t, uint64_t>;
+
+  // Existing streams are read through |reader|.
+  Streams(sqlite::database db, sqlite::database reader,
+          std::shared_ptr<PreparedStatements> statements,
+          std::shared_ptr<DBWriter> writer);
 
   void InitTable();
 
-  std::vector<std::shared_ptr<Stream>> GetAllUpdatedSince(uint64_t timestamp);
+  std::vector<std::shared_ptr<Stream>> TakeUpdated();
 
   std::vector<std::shared_ptr<Stream>> GetAllWithRustlers();
 
@@ -193,6 +279,9 @@ class Streams {
 
   std::string GetAPIJSON();
 
+  static std::string GetAPIJSON(
+      const std::vector<std::shared_ptr<Stream>> &streams);
+
   void WriteStreamsJSON(rapidjson::Writer<rapidjson::StringBuffer> *writer);
 
   std::shared_ptr<Stream> GetByID(const uint64_t id) {
@@ -216,9 +305,23 @@ class Streams {
                                   const std::string &overrustle_id);
 
  private:
+  // Apply queued rustler count changes. Requires |lock_| held exclusively.
+  void SyncRanking();
+
   sqlite::database db_;
+  std::shared_ptr<PreparedStatements> statements_;
+  std::shared_ptr<DBWriter> writer_;
+  std::shared_ptr<StreamUpdateQueue> updates_;
   boost::shared_mutex lock_;
   std::unordered_map<uint64_t, std::shared_ptr<Stream>> data_by_id_;
+  // streams with rustlers ordered by rustler count descending. Updated from
+  // SyncRanking; |ranked_counts_| holds the count each stream is ranked at.
+  std::map<RankingKey, std::shared_ptr<Stream>, std::greater<RankingKey>>
+      ranking_;
+  std::unordered_map<uint64_t, uint64_t> ranked_counts_;
+  // streams re-ranked since the last TakeUpdated
+  std::vector<std::shared_ptr<Stream>> untaken_;
+  std::unordered_set<uint64_t> untaken_ids_;
   std::unordered_map<Channel, std::shared_ptr<Stream>, ChannelHash,
                      ChannelEqual>
       data_by_channel_;
@@ -0,0 +1,98 @@
+#include "StreamsDelta.h"
+
+namespace rustla2 {
+
+/**
+ * Serialize the supplied streams and diff them against the entries from the
+ * previous update. Returns true and advances the sequence number if anything
+ * changed.
+ */
+bool StreamsDelta::Update(const std::vector<std::shared_ptr<Stream>> &streams) {
+  std::unordered_map<uint64_t, std::string> entries;
+  std::vector<uint64_t> order;
+  std::vector<uint64_t> changed;
+  order.reserve(streams.size());
+
+  for (const auto &stream : streams) {
+    buf_.Clear();
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buf_);
+    stream->WriteJSON(&writer);
+
+    const auto id = stream->GetID();
+    std::string entry(buf_.GetString(), buf_.GetSize());
+
+    auto it = entries_.find(id);
+    if (it == entries_.end() || it->second != entry) {
+      changed.push_back(id);
+    }
+
+    order.push_back(id);
+    entries.emplace(id, std::move(entry));
+  }
+
+  std::vector<uint64_t> removed;
+  for (const auto &it : entries_) {
+    if (entries.count(it.first) == 0) {
+      removed.push_back(it.first);
+    }
+  }
+
+  if (seq_ != 0 && changed.empty() && removed.empty()) {
+    return false;
+  }
+
+  ++seq_;
+  order_.swap(order);
+  entries_.swap(entries);
+  changed_.swap(changed);
+  removed_.swap(removed);
+
+  return true;
+}
+
+/**
+ * Write the full stream list as ["STREAMS_SET", [streams...], seq]. Clients
+ * that don't understand patches ignore the trailing sequence number.
+ */
+void StreamsDelta::WriteStreamsSetJSON(
+    rapidjson::Writer<rapidjson::StringBuffer> *writer) {
+  writer->StartArray();
+  writer->String("STREAMS_SET");
+  writer->StartArray();
+  for (const auto id : order_) {
+    WriteEntry(id, writer);
+  }
+  writer->EndArray();
+  writer->Uint64(seq_);
+  writer->EndArray();
+}
+
+/**
+ * Write the changes from the previous sequence number as
+ * ["STREAMS_PATCH", seq, [added or changed streams...], [removed ids...]].
+ */
+void StreamsDelta::WriteStreamsPatchJSON(
+    rapidjson::Writer<rapidjson::StringBuffer> *writer) {
+  writer->StartArray();
+  writer->String("STREAMS_PATCH");
+  writer->Uint64(seq_);
+  writer->StartArray();
+  for (const auto id : changed_) {
+    WriteEntry(id, writer);
+  }
+  writer->EndArray();
+  writer->StartArray();
+  for (const auto id : removed_) {
+    writer->Uint64(id);
+  }
+  writer->EndArray();
+  writer->EndArray();
+}
+
+void StreamsDelta::WriteEntry(
+    const uint64_t id, rapidjson::Writer<rapidjson::StringBuffer> *writer) {
+  const auto &entry = entries_[id];
+  writer->RawValue(entry.data(), entry.size(), rapidjson::kObjectType);
+}
+
+}  // namespace rustla2
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Streams.h"
+
+namespace rustla2 {
+
+/**
+ * Tracks the stream list sent to clients between STREAMS_SET broadcasts so
+ * changes can be sent as STREAMS_PATCH messages containing only the entries
+ * that were added, changed or removed since the previous sequence number.
+ */
+class StreamsDelta {
+ public:
+  bool Update(const std::vector<std::shared_ptr<Stream>> &streams);
+
+  uint64_t GetSeq() const { return seq_; }
+
+  void WriteStreamsSetJSON(rapidjson::Writer<rapidjson::StringBuffer> *writer);
+
+  void WriteStreamsPatchJSON(
+      rapidjson::Writer<rapidjson::StringBuffer> *writer);
+
+ private:
+  void WriteEntry(const uint64_t id,
+                  rapidjson::Writer<rapidjson::StringBuffer> *writer);
+
+  uint64_t seq_{0};
+  rapidjson::StringBuffer buf_;
+  std::vector<uint64_t> order_;
+  std::unordered_map<uint64_t, std::string> entries_;
+  std::vector<uint64_t> changed_;
+  std::vector<uint64_t> removed_;
+};
+
+}  // namespace rustla2
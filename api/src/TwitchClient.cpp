@@ -2,6 +2,7 @@
 
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
+#include <sstream>
 
 #include "JSON.h"
 
@@ -149,6 +150,77 @@ std::string StreamsResult::GetLargePreview() const {
   return json::StringRef(GetData()["stream"]["preview"]["large"]);
 }
 
+uint64_t LiveStreamsResult::Stream::GetChannelID() const {
+  // kraken has returned ids as both numbers and strings
+  const auto& id = data_["channel"]["_id"];
+  return id.IsUint64() ? id.GetUint64()
+                       : std::stoull(std::string(json::StringRef(id)));
+}
+
+uint64_t LiveStreamsResult::Stream::GetViewers() const {
+  return data_["viewers"].GetUint64();
+}
+
+std::string LiveStreamsResult::Stream::GetLargePreview() const {
+  return json::StringRef(data_["preview"]["large"]);
+}
+
+std::string LiveStreamsResult::GetSchema() {
+  return R"json(
+      {
+        "type": "object",
+        "properties": {
+          "streams": {
+            "type": "array",
+            "items": {
+              "type": "object",
+              "properties": {
+                "channel": {
+                  "type": "object",
+                  "properties": {
+                    "_id": {
+                      "anyOf": [
+                        {"type": "integer"},
+                        {
+                          "type": "string",
+                          "pattern": "^[0-9]+$"
+                        }
+                      ]
+                    }
+                  },
+                  "required": ["_id"]
+                },
+                "viewers": {"type": "integer"},
+                "preview": {
+                  "type": "object",
+                  "properties": {
+                    "large": {
+                      "type": "string",
+                      "format": "uri"
+                    }
+                  },
+                  "required": ["large"]
+                }
+              },
+              "required": ["channel", "viewers", "preview"]
+            }
+          }
+        },
+        "required": ["streams"]
+      }
+    )json";
+}
+
+size_t LiveStreamsResult::GetSize() const {
+  return GetData()["streams"].Size();
+}
+
+const LiveStreamsResult::Stream LiveStreamsResult::GetStream(
+    const size_t index) const {
+  const auto& streams = GetData()["streams"].GetArray();
+  return Stream(streams[index]);
+}
+
 std::string ChannelsResult::GetSchema() {
   return R"json(
       {
@@ -228,7 +300,7 @@ Status Client::GetOAuthToken(const std::string& code, AuthTokenResult* result) {
   req.SetPostData(json.GetString(), json.GetSize());
   req.Submit();
 
-  return LoadResultFromCurlRequest(req, result);
+  return LoadResultFromCurlRequest(&req, result);
 }
 
 Status Client::GetUserByOAuthToken(const std::string& token,
@@ -239,7 +311,7 @@ Status Client::GetUserByOAuthToken(const std::string& token,
   req.AddHeader("Accept: application/vnd.twitchtv.v5+json");
   req.Submit();
 
-  return LoadResultFromCurlRequest(req, result);
+  return LoadResultFromCurlRequest(&req, result);
 }
 
 Status Client::GetUsersByName(const std::string& name, UsersResult* result) {
@@ -252,6 +324,16 @@ Status Client::GetStreamByID(const uint64_t channel_id, StreamsResult* result) {
   return LoadResultFromURL(url, result);
 }
 
+Status Client::GetStreamsByIDs(const std::vector<uint64_t>& channel_ids,
+                               LiveStreamsResult* result) {
+  std::stringstream path;
+  path << "streams?limit=" << kMaxStreamsPerRequest << "&channel=";
+  for (size_t i = 0; i < channel_ids.size(); ++i) {
+    path << (i == 0 ? "" : ",") << channel_ids[i];
+  }
+  return LoadResultFromURL(GetKrakenURL(path.str()), result);
+}
+
 Status Client::GetChannelByID(const uint64_t channel_id,
                               ChannelsResult* result) {
   auto url = GetKrakenURL("channels/" + std::to_string(channel_id));
@@ -2,6 +2,7 @@
 
 #include <rapidjson/document.h>
 #include <string>
+#include <vector>
 
 #include "APIClient.h"
 #include "Curl.h"
@@ -10,6 +11,9 @@
 namespace rustla2 {
 namespace twitch {
 
+// most channels the streams endpoint accepts in one request
+constexpr size_t kMaxStreamsPerRequest = 100;
+
 class ErrorResult : public APIResult {
  public:
   std::string GetSchema() override final;
@@ -67,6 +71,33 @@ class StreamsResult : public APIResult {
   std::string GetLargePreview() const;
 };
 
+/**
+ * Live streams for a list of channels. Channels that aren't live are left
+ * out, so results are matched back to channels by id.
+ */
+class LiveStreamsResult : public APIResult {
+ public:
+  class Stream {
+   public:
+    explicit Stream(const rapidjson::Value& data) : data_(data) {}
+
+    uint64_t GetChannelID() const;
+
+    uint64_t GetViewers() const;
+
+    std::string GetLargePreview() const;
+
+   private:
+    const rapidjson::Value& data_;
+  };
+
+  std::string GetSchema() override final;
+
+  size_t GetSize() const;
+
+  const LiveStreamsResult::Stream GetStream(const size_t index) const;
+};
+
 class ChannelsResult : public APIResult {
  public:
   std::string GetSchema() override final;
@@ -101,6 +132,10 @@ class Client {
 
   Status GetStreamByID(const uint64_t channel_id, StreamsResult* result);
 
+  // At most kMaxStreamsPerRequest channels may be requested at once.
+  Status GetStreamsByIDs(const std::vector<uint64_t>& channel_ids,
+                         LiveStreamsResult* result);
+
   Status GetChannelByID(const uint64_t channel_id, ChannelsResult* result);
 
   Status GetVideosByID(const std::string& video_id, VideosResult* result);
@@ -117,18 +152,18 @@ class Client {
     req.AddHeader("Client-ID: " + config_.client_id);
     req.Submit();
 
-    return LoadResultFromCurlRequest(req, result);
+    return LoadResultFromCurlRequest(&req, result);
   }
 
   template <typename T>
-  Status LoadResultFromCurlRequest(const CurlRequest& req, T* result) {
-    if (!req.Ok()) {
-      return Status(StatusCode::HTTP_ERROR, req.GetErrorMessage());
+  Status LoadResultFromCurlRequest(CurlRequest* req, T* result) {
+    if (!req->Ok()) {
+      return Status(StatusCode::HTTP_ERROR, req->GetErrorMessage());
     }
 
-    const auto& response = req.GetResponse();
+    const auto& response = req->GetResponse();
 
-    if (req.GetResponseCode() != 200) {
+    if (req->GetResponseCode() != 200) {
       ErrorResult error;
       if (error.SetData(response.c_str(), response.size()).Ok()) {
         return Status(StatusCode::API_ERROR, error.GetError(),
@@ -137,7 +172,7 @@ class Client {
       return Status::ERROR;
     }
 
-    return result->SetData(response.c_str(), response.size());
+    return result->SetData(req->TakeResponse());
   }
 
   ClientConfig config_;
@@ -0,0 +1,114 @@
+#include "TwitchUserIDs.h"
+
+#include <folly/String.h>
+#include <glog/logging.h>
+
+#include "Config.h"
+
+namespace rustla2 {
+
+TwitchUserIDs::TwitchUserIDs(sqlite::database db, sqlite::database reader,
+                             std::shared_ptr<PreparedStatements> statements,
+                             std::shared_ptr<DBWriter> writer)
+    : db_(db),
+      statements_(statements),
+      writer_(writer),
+      ttl_(Config::Get().GetTwitchUserIDTTL()),
+      negative_ttl_(Config::Get().GetTwitchUserIDNegativeTTL()) {
+  InitTable();
+
+  auto sql = R"sql(
+      SELECT
+        `login`,
+        `user_id`,
+        `resolved_at`
+      FROM `twitch_user_ids`
+    )sql";
+  auto query = reader << sql;
+
+  query >> [&](const std::string& login, const uint64_t id,
+               const time_t resolved_at) {
+    data_[login] = Entry{id, resolved_at};
+  };
+
+  LOG(INFO) << "read " << data_.size() << " twitch user ids";
+}
+
+void TwitchUserIDs::InitTable() {
+  auto sql = R"sql(
+      CREATE TABLE IF NOT EXISTS `twitch_user_ids` (
+        `login` VARCHAR(255) PRIMARY KEY,
+        `user_id` INTEGER NOT NULL,
+        `resolved_at` INTEGER NOT NULL
+      );
+    )sql";
+  db_ << sql;
+}
+
+TwitchUserIDs::Result TwitchUserIDs::Get(const std::string& login,
+                                         uint64_t* id) {
+  auto key = login;
+  folly::toLowerAscii(key);
+
+  boost::shared_lock<boost::shared_mutex> read_lock(lock_);
+  auto it = data_.find(key);
+  if (it == data_.end()) {
+    return MISS;
+  }
+
+  const auto& entry = it->second;
+  const auto ttl = entry.id == 0 ? negative_ttl_ : ttl_;
+  if (entry.resolved_at + ttl < time(nullptr)) {
+    return MISS;
+  }
+
+  if (entry.id == 0) {
+    return NOT_FOUND;
+  }
+  *id = entry.id;
+  return FOUND;
+}
+
+void TwitchUserIDs::Set(const std::string& login, const uint64_t id) {
+  auto key = login;
+  folly::toLowerAscii(key);
+  const auto resolved_at = time(nullptr);
+
+  const void* write_key;
+  {
+    boost::unique_lock<boost::shared_mutex> write_lock(lock_);
+    auto& entry = data_[key];
+    entry = Entry{id, resolved_at};
+    // entries are never erased, so their addresses identify them
+    write_key = &entry;
+  }
+
+  auto statements = statements_;
+  writer_->Enqueue(write_key, [statements, key, id, resolved_at]() {
+    try {
+      const auto sql = R"sql(
+          INSERT OR REPLACE INTO `twitch_user_ids` (
+            `login`,
+            `user_id`,
+            `resolved_at`
+          )
+          VALUES (?, ?, ?)
+        )sql";
+      auto query = statements->Get(sql);
+      query << key << id << resolved_at;
+      query.Execute();
+    } catch (const sqlite::sqlite_exception& e) {
+      LOG(ERROR) << "error storing twitch user id "
+                 << "login: " << key << ", "
+                 << "user_id: " << id << ", "
+                 << "error: " << e.what() << ", "
+                 << "code: " << e.get_extended_code();
+
+      return false;
+    }
+
+    return true;
+  });
+}
+
+}  // namespace rustla2
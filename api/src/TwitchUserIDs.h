@@ -0,0 +1,57 @@
+#pragma once
+
+#include <sqlite_modern_cpp.h>
+#include <boost/thread/shared_mutex.hpp>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "DBWriter.h"
+#include "PreparedStatements.h"
+
+namespace rustla2 {
+
+/**
+ * Twitch login to user id mappings, so polling a stream doesn't need to look
+ * its user up first. Held in memory and written behind to SQLite so they
+ * survive restarts. Logins Twitch has no user for are remembered too, for a
+ * shorter time, so typos don't cost a request every poll.
+ */
+class TwitchUserIDs {
+ public:
+  enum Result { MISS, FOUND, NOT_FOUND };
+
+  // Existing mappings are read through |reader|.
+  TwitchUserIDs(sqlite::database db, sqlite::database reader,
+                std::shared_ptr<PreparedStatements> statements,
+                std::shared_ptr<DBWriter> writer);
+
+  void InitTable();
+
+  /**
+   * Look up |login|, setting |id| if it's FOUND. Mappings older than their
+   * TTL are a MISS.
+   */
+  Result Get(const std::string& login, uint64_t* id);
+
+  // Remember |login|'s user |id|, or 0 if Twitch has no such user.
+  void Set(const std::string& login, const uint64_t id);
+
+ private:
+  struct Entry {
+    uint64_t id;
+    time_t resolved_at;
+  };
+
+  sqlite::database db_;
+  std::shared_ptr<PreparedStatements> statements_;
+  std::shared_ptr<DBWriter> writer_;
+  const time_t ttl_;
+  const time_t negative_ttl_;
+  boost::shared_mutex lock_;
+  std::unordered_map<std::string, Entry> data_;
+};
+
+}  // namespace rustla2
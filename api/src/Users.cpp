@@ -63,7 +63,22 @@ void User::WriteJSON(rapidjson::Writer<rapidjson::StringBuffer> *writer) {
   writer->EndObject();
 }
 
-bool User::Save() {
+void User::Save() {
+  auto self = shared_from_this();
+  writer_->Enqueue(this, [self]() { return self->WriteUpdate(); });
+}
+
+bool User::SaveNow() {
+  auto self = shared_from_this();
+  return writer_->WriteNow(this, [self]() { return self->WriteUpdate(); });
+}
+
+void User::SaveNew() {
+  auto self = shared_from_this();
+  writer_->Enqueue(this, [self]() { return self->WriteInsert(); }, true);
+}
+
+bool User::WriteUpdate() {
   boost::shared_lock<boost::shared_mutex> read_lock(lock_);
   try {
     const auto sql = R"sql(
@@ -78,8 +93,10 @@ bool User::Save() {
           `updated_at` = datetime()
         WHERE `id` = ?
       )sql";
-    db_ << sql << channel_->GetService() << channel_->GetChannel() << last_ip_
-        << last_seen_ << left_chat_ << is_admin_ << is_banned_ << id_;
+    auto query = statements_->Get(sql);
+    query << channel_->GetService() << channel_->GetChannel() << last_ip_
+          << last_seen_ << left_chat_ << is_admin_ << is_banned_ << id_;
+    query.Execute();
   } catch (const sqlite::sqlite_exception &e) {
     LOG(ERROR) << "error updating user "
                << "id: " << id_ << ", "
@@ -98,7 +115,7 @@ bool User::Save() {
   return true;
 }
 
-bool User::SaveNew() {
+bool User::WriteInsert() {
   boost::shared_lock<boost::shared_mutex> read_lock(lock_);
   try {
     const auto sql = R"sql(
@@ -129,9 +146,10 @@ bool User::SaveNew() {
           datetime()
         )
       )sql";
-    db_ << sql << id_ << name_ << channel_->GetService()
-        << channel_->GetChannel() << last_ip_ << last_seen_ << left_chat_
-        << is_admin_ << is_banned_;
+    auto query = statements_->Get(sql);
+    query << id_ << name_ << channel_->GetService() << channel_->GetChannel()
+          << last_ip_ << last_seen_ << left_chat_ << is_admin_ << is_banned_;
+    query.Execute();
   } catch (const sqlite::sqlite_exception &e) {
     LOG(ERROR) << "error creating user "
                << "id: " << id_ << ", "
@@ -151,7 +169,12 @@ bool User::SaveNew() {
   return true;
 }
 
-Users::Users(sqlite::database db) : db_(db) {
+Users::Users(sqlite::database db, sqlite::database reader,
+             std::shared_ptr<PreparedStatements> statements,
+             std::shared_ptr<DBWriter> writer)
+    : db_(db),
+      statements_(statements),
+      writer_(writer) {
   InitTable();
 
   auto sql = R"sql(
@@ -167,7 +190,7 @@ Users::Users(sqlite::database db) : db_(db) {
         `is_banned`
       FROM `users`
     )sql";
-  auto query = db_ << sql;
+  auto query = reader << sql;
 
   query >> [&](const uint64_t id, const std::string &name,
                const std::string &service, const std::string &channel,
@@ -175,8 +198,8 @@ Users::Users(sqlite::database db) : db_(db) {
                const bool left_chat, const bool is_admin,
                const bool is_banned) {
     auto user = std::make_shared<User>(
-        db_, id, name, Channel::Create(channel, service), last_ip, last_seen,
-        left_chat, is_admin, is_banned);
+        statements_, writer_, id, name, Channel::Create(channel, service),
+        last_ip, last_seen, left_chat, is_admin, is_banned);
 
     data_by_id_[id] = user;
     data_by_name_[name] = user;
@@ -208,7 +231,7 @@ void Users::InitTable() {
 std::shared_ptr<User> Users::Emplace(const std::string &name,
                                      const Channel &channel,
                                      const std::string &ip) {
-  auto user = std::make_shared<User>(db_, name, channel, ip);
+  auto user = std::make_shared<User>(statements_, writer_, name, channel, ip);
 
   {
     boost::unique_lock<boost::shared_mutex> write_lock(lock_);
@@ -10,17 +10,21 @@
 #include <unordered_map>
 
 #include "Channel.h"
+#include "DBWriter.h"
+#include "PreparedStatements.h"
 #include "JSON.h"
 
 namespace rustla2 {
 
-class User {
+class User : public std::enable_shared_from_this<User> {
  public:
-  User(sqlite::database db, const uint64_t id, const std::string &name,
-       const Channel &channel, const std::string &last_ip,
-       const time_t last_seen, const bool left_chat, const bool is_admin,
-       const bool is_banned)
-      : db_(db),
+  User(std::shared_ptr<PreparedStatements> statements,
+       std::shared_ptr<DBWriter> writer, const uint64_t id,
+       const std::string &name, const Channel &channel,
+       const std::string &last_ip, const time_t last_seen,
+       const bool left_chat, const bool is_admin, const bool is_banned)
+      : statements_(statements),
+        writer_(writer),
         id_(id),
         name_(name),
         channel_(std::shared_ptr<Channel>(channel)),
@@ -30,9 +34,11 @@ class User {
         is_admin_(is_admin),
         is_banned_(is_banned) {}
 
-  User(sqlite::database db, const std::string &name, const Channel &channel,
-       const std::string &last_ip)
-      : db_(db),
+  User(std::shared_ptr<PreparedStatements> statements,
+       std::shared_ptr<DBWriter> writer, const std::string &name,
+       const Channel &channel, const std::string &last_ip)
+      : statements_(statements),
+        writer_(writer),
         id_(std::hash<std::string>{}(name)&json::kMaxIntSize),
         name_(name),
         channel_(std::shared_ptr<Channel>(channel)),
@@ -109,12 +115,21 @@ class User {
     is_banned_ = is_banned;
   }
 
-  bool Save();
+  // Queue the user to be written by the DBWriter.
+  void Save();
 
-  bool SaveNew();
+  // Write the user now, returning false if it wasn't saved.
+  bool SaveNow();
+
+  void SaveNew();
 
  private:
-  sqlite::database db_;
+  bool WriteUpdate();
+
+  bool WriteInsert();
+
+  std::shared_ptr<PreparedStatements> statements_;
+  std::shared_ptr<DBWriter> writer_;
   boost::shared_mutex lock_;
   const uint64_t id_;
   const std::string name_;
@@ -128,7 +143,10 @@ class User {
 
 class Users {
  public:
-  Users(sqlite::database db);
+  // Existing users are read through |reader|.
+  Users(sqlite::database db, sqlite::database reader,
+        std::shared_ptr<PreparedStatements> statements,
+        std::shared_ptr<DBWriter> writer);
 
   void InitTable();
 
@@ -156,6 +174,8 @@ class Users {
 
  private:
   sqlite::database db_;
+  std::shared_ptr<PreparedStatements> statements_;
+  std::shared_ptr<DBWriter> writer_;
   boost::shared_mutex lock_;
   std::unordered_map<uint64_t, std::shared_ptr<User>> data_by_id_;
   std::unordered_map<std::string, std::shared_ptr<User>> data_by_name_;
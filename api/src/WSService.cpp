@@ -1,6 +1,9 @@
 #include "WSService.h"
 
-#include <chrono>
+#include <folly/String.h>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "Config.h"
 #include "HTTPRequest.h"
@@ -8,26 +11,37 @@
 
 namespace rustla2 {
 
-WSService::WSService(std::shared_ptr<DB> db, uWS::Hub* hub)
+namespace {
+
+const std::vector<std::pair<std::string, WSCapability>> kCapabilityNames{
+    {"STREAMS_PATCH", WSCapability::STREAMS_PATCH},
+    {"RUSTLERS_BATCH", WSCapability::RUSTLERS_BATCH}};
+
+// uWS accepts any permessage-deflate offer when the hub enables it
+bool AcceptsDeflate(uWS::HttpRequest req) {
+  auto header = req.getHeader("sec-websocket-extensions");
+  return folly::StringPiece(header.value, header.valueLength)
+      .contains("permessage-deflate");
+}
+
+}  // namespace
+
+WSService::WSService(std::shared_ptr<DB> db,
+                     std::shared_ptr<Broadcaster> broadcaster, uWS::Hub* hub)
     : db_(db),
+      broadcaster_(broadcaster),
+      broadcasts_(broadcaster->Subscribe()),
       hub_(hub),
-      stream_broadcast_timer_(hub->getLoop()),
-      rustler_broadcast_timer_(hub->getLoop()) {
-  // Run separate stream/rustler broadcast loops for each hub so we don't
-  // need to use thread safe queues.
-  stream_broadcast_timer_.setData(this);
-  stream_broadcast_timer_.start(
+      broadcast_timer_(hub->getLoop()),
+      compression_(Config::Get().GetWSCompression()),
+      last_streams_json_(broadcaster->GetStreamsSetJSON()) {
+  // Broadcast payloads are built once by the Broadcaster and queued for each
+  // hub, so the hub only needs to drain its queue on its own loop.
+  broadcast_timer_.setData(this);
+  broadcast_timer_.start(
       [](Timer* timer) {
         auto* websocket = static_cast<WSService*>(timer->getData());
-        websocket->BroadcastStreams();
-      },
-      0, Config::Get().GetStreamBroadcastInterval());
-
-  rustler_broadcast_timer_.setData(this);
-  rustler_broadcast_timer_.start(
-      [](Timer* timer) {
-        auto* websocket = static_cast<WSService*>(timer->getData());
-        websocket->BroadcastRustlers();
+        websocket->ProcessBroadcasts();
       },
       0, Config::Get().GetRustlerBroadcastInterval());
 
@@ -36,8 +50,10 @@ WSService::WSService(std::shared_ptr<DB> db, uWS::Hub* hub)
       return;
     }
 
-    ws->send(last_streams_json_.data(), last_streams_json_.size(),
-             uWS::OpCode::TEXT);
+    auto* client = new WSClient();
+    client->compression = compression_ && AcceptsDeflate(req);
+    ws->setUserData(client);
+    SendStreamsSet(ws);
   });
 
   hub->onMessage([&](uWS::WebSocket<uWS::SERVER>* ws, char* message,
@@ -63,18 +79,24 @@ WSService::WSService(std::shared_ptr<DB> db, uWS::Hub* hub)
       SetStream(ws, input);
     } else if (method == "getStream") {
       GetStream(ws, input);
+    } else if (method == "getStreams") {
+      GetStreams(ws);
+    } else if (method == "setCapabilities") {
+      SetCapabilities(ws, input);
     }
   });
 
   hub->onDisconnection([&](uWS::WebSocket<uWS::SERVER>* ws, int code,
-                           char* message, size_t length) { UnsetStream(ws); });
+                           char* message, size_t length) {
+    UnsetStream(ws);
+    delete GetClient(ws);
+    ws->setUserData(nullptr);
+  });
 }
 
 WSService::~WSService() {
-  stream_broadcast_timer_.stop();
-  stream_broadcast_timer_.close();
-  rustler_broadcast_timer_.stop();
-  rustler_broadcast_timer_.close();
+  broadcast_timer_.stop();
+  broadcast_timer_.close();
 }
 
 bool WSService::RejectBannedIP(uWS::WebSocket<uWS::SERVER>* ws,
@@ -111,6 +133,49 @@ void WSService::GetStream(uWS::WebSocket<uWS::SERVER>* ws,
   ws->send(buf_.GetString(), buf_.GetSize(), uWS::OpCode::TEXT);
 }
 
+/**
+ * Resend the full STREAMS_SET list. Clients request this when they miss a
+ * STREAMS_PATCH sequence number.
+ */
+void WSService::GetStreams(uWS::WebSocket<uWS::SERVER>* ws) {
+  SendStreamsSet(ws);
+}
+
+void WSService::SendStreamsSet(uWS::WebSocket<uWS::SERVER>* ws) {
+  if (last_streams_json_ != nullptr) {
+    ws->send(last_streams_json_->data(), last_streams_json_->size(),
+             uWS::OpCode::TEXT);
+  }
+}
+
+/**
+ * Record the optional protocol features supported by the client. Unknown
+ * capability names are ignored so clients can be updated ahead of the server.
+ * ex: ["setCapabilities", "STREAMS_PATCH", "RUSTLERS_BATCH"]
+ */
+void WSService::SetCapabilities(uWS::WebSocket<uWS::SERVER>* ws,
+                                const rapidjson::Document& input) {
+  auto* client = GetClient(ws);
+  if (client == nullptr) {
+    return;
+  }
+
+  client->capabilities = 0;
+  const auto& command = input.GetArray();
+  for (size_t i = 1; i < command.Size(); ++i) {
+    if (!command[i].IsString()) {
+      continue;
+    }
+
+    const json::StringRef name(command[i]);
+    for (const auto& capability : kCapabilityNames) {
+      if (name == capability.first) {
+        client->capabilities |= capability.second;
+      }
+    }
+  }
+}
+
 /**
  * Handle requests for streams by id
  */
@@ -174,7 +239,11 @@ void WSService::SetStream(uWS::WebSocket<uWS::SERVER>* ws,
 
   writer.EndArray();
   ws->send(buf_.GetString(), buf_.GetSize(), uWS::OpCode::TEXT);
-  ws->setUserData(reinterpret_cast<void*>(stream_id));
+
+  auto* client = GetClient(ws);
+  if (client != nullptr) {
+    client->stream_id = stream_id;
+  }
 }
 
 /**
@@ -255,76 +324,92 @@ void WSService::SetStreamToNull(
  * Clear the stream id associated with the supplied client
  */
 void WSService::UnsetStream(uWS::WebSocket<uWS::SERVER>* ws) {
-  auto stream_id = reinterpret_cast<uint64_t>(ws->getUserData());
+  auto* client = GetClient(ws);
 
-  if (stream_id != 0) {
-    auto stream = db_->GetStreams()->GetByID(stream_id);
+  if (client != nullptr && client->stream_id != 0) {
+    auto stream = db_->GetStreams()->GetByID(client->stream_id);
     if (stream != nullptr) {
       stream->DecrRustlerCount();
     }
-    ws->setUserData(reinterpret_cast<void*>(0));
+    client->stream_id = 0;
   }
 }
 
 /**
- * Generate STREAMS_SET broadcasts. Syncs updates from upstream services
- * ie. liveness, thumbnail, and viewer count.
+ * Send a message to every client on this hub accepted by |filter|. Each
+ * variant of the message is framed at most once per hub and the identical
+ * bytes are shared by all of the recipients. Clients that negotiated
+ * permessage-deflate get the payload compressed by the Broadcaster.
  */
-void WSService::BroadcastStreams() {
-  buf_.Clear();
-  rapidjson::Writer<rapidjson::StringBuffer> writer(buf_);
-
-  writer.StartArray();
-  writer.String("STREAMS_SET");
-  db_->GetStreams()->WriteStreamsJSON(&writer);
-  writer.EndArray();
+void WSService::BroadcastFiltered(const BroadcastMessage& message,
+                                  std::function<bool(WSClient*)> filter) {
+  using WebSocket = uWS::WebSocket<uWS::SERVER>;
+  WebSocket::PreparedMessage* plain = nullptr;
+  WebSocket::PreparedMessage* deflated = nullptr;
+
+  hub_->getDefaultGroup<uWS::SERVER>().forEach([&](WebSocket* ws) {
+    auto* client = GetClient(ws);
+    if (client == nullptr || !filter(client)) {
+      return;
+    }
 
-  // if the list hasn't changed don't rebroadcast it
-  if (last_streams_json_.compare(buf_.GetString()) != 0) {
-    hub_->getDefaultGroup<uWS::SERVER>().broadcast(
-        buf_.GetString(), buf_.GetSize(), uWS::OpCode::TEXT);
+    if (client->compression && !message.deflated.empty()) {
+      if (deflated == nullptr) {
+        deflated = WebSocket::prepareMessage(
+            const_cast<char*>(message.deflated.data()),
+            message.deflated.size(), uWS::OpCode::TEXT, true);
+      }
+      ws->sendPrepared(deflated);
+    } else {
+      if (plain == nullptr) {
+        plain = WebSocket::prepareMessage(
+            const_cast<char*>(message.data.data()), message.data.size(),
+            uWS::OpCode::TEXT, false);
+      }
+      ws->sendPrepared(plain);
+    }
+  });
 
-    last_streams_json_.assign(buf_.GetString(), buf_.GetSize());
+  if (plain != nullptr) {
+    WebSocket::finalizeMessage(plain);
+  }
+  if (deflated != nullptr) {
+    WebSocket::finalizeMessage(deflated);
   }
 }
 
 /**
- * Generate RUSTLERS_SET broadcasts for any streams whose rustler counts
- * changed recently. Handling this in a polling loop reduces the cost of
- * syncing clients by debouncing updates and creates a knob for load shedding.
+ * Send queued broadcasts to the clients on this hub. If the queue overflowed
+ * while this hub was busy the missed broadcasts are replaced by resending the
+ * latest STREAMS_SET to every client.
  */
-void WSService::BroadcastRustlers() {
-  auto last_rustler_broadcast_time =
-      std::chrono::duration_cast<std::chrono::nanoseconds>(
-          std::chrono::steady_clock::now().time_since_epoch())
-          .count();
-  auto streams =
-      db_->GetStreams()->GetAllUpdatedSince(last_rustler_broadcast_time_);
-
-  for (const auto& stream : streams) {
-    buf_.Clear();
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buf_);
-    writer.StartArray();
-
-    // If the stream was reset since the last RUSTLERS_SET broadcast it's
-    // a safe bet clients haven't received it via STREAMS_SET. Rather than
-    // broadcasting the id and triggering a flood of `getStream` requests
-    // broadcast the change as a STREAM_GET.
-    if (stream->GetResetTime() >= last_rustler_broadcast_time_) {
-      writer.String("STREAM_GET");
-      stream->WriteJSON(&writer);
-    } else {
-      writer.String("RUSTLERS_SET");
-      writer.Uint64(stream->GetID());
-      writer.Uint64(stream->GetRustlerCount());
+void WSService::ProcessBroadcasts() {
+  std::shared_ptr<const Broadcast> broadcast;
+
+  if (broadcasts_->TakeOverflow()) {
+    while (broadcasts_->Read(&broadcast)) {
     }
 
-    writer.EndArray();
-    hub_->getDefaultGroup<uWS::SERVER>().broadcast(
-        buf_.GetString(), buf_.GetSize(), uWS::OpCode::TEXT);
+    last_streams_json_ = broadcaster_->GetStreamsSetJSON();
+    if (last_streams_json_ != nullptr) {
+      BroadcastFiltered(BroadcastMessage(last_streams_json_->data(),
+                                         last_streams_json_->size()),
+                        [](WSClient* client) { return true; });
+    }
+    return;
   }
 
-  last_rustler_broadcast_time_ = last_rustler_broadcast_time;
+  while (broadcasts_->Read(&broadcast)) {
+    if (broadcast->streams_set != nullptr) {
+      last_streams_json_ = broadcast->streams_set;
+    }
+
+    for (const auto& message : broadcast->messages) {
+      BroadcastFiltered(message, [&](WSClient* client) {
+        return message.Accepts(client->capabilities);
+      });
+    }
+  }
 }
 
 }  // namespace rustla2
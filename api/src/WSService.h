@@ -4,16 +4,26 @@
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <uWS/uWS.h>
+#include <functional>
 #include <memory>
+#include <string>
 
+#include "Broadcaster.h"
 #include "Channel.h"
 #include "DB.h"
 
 namespace rustla2 {
 
+struct WSClient {
+  uint64_t stream_id{0};
+  uint32_t capabilities{0};
+  bool compression{false};
+};
+
 class WSService {
  public:
-  WSService(std::shared_ptr<DB> db, uWS::Hub* hub);
+  WSService(std::shared_ptr<DB> db, std::shared_ptr<Broadcaster> broadcaster,
+            uWS::Hub* hub);
 
   ~WSService();
 
@@ -23,6 +33,11 @@ class WSService {
   void GetStream(uWS::WebSocket<uWS::SERVER>* ws,
                  const rapidjson::Document& input);
 
+  void GetStreams(uWS::WebSocket<uWS::SERVER>* ws);
+
+  void SetCapabilities(uWS::WebSocket<uWS::SERVER>* ws,
+                       const rapidjson::Document& input);
+
   void GetStreamByID(const uint64_t stream_id,
                      rapidjson::Writer<rapidjson::StringBuffer>* writer);
 
@@ -48,18 +63,26 @@ class WSService {
 
   void UnsetStream(uWS::WebSocket<uWS::SERVER>* ws);
 
-  void BroadcastStreams();
-
-  void BroadcastRustlers();
+  void ProcessBroadcasts();
 
  private:
+  WSClient* GetClient(uWS::WebSocket<uWS::SERVER>* ws) {
+    return static_cast<WSClient*>(ws->getUserData());
+  }
+
+  void BroadcastFiltered(const BroadcastMessage& message,
+                         std::function<bool(WSClient*)> filter);
+
+  void SendStreamsSet(uWS::WebSocket<uWS::SERVER>* ws);
+
   std::shared_ptr<DB> db_;
+  std::shared_ptr<Broadcaster> broadcaster_;
+  std::shared_ptr<BroadcastQueue> broadcasts_;
   uWS::Hub* hub_;
-  Timer stream_broadcast_timer_;
-  Timer rustler_broadcast_timer_;
+  Timer broadcast_timer_;
   rapidjson::StringBuffer buf_;
-  uint64_t last_rustler_broadcast_time_{0};
-  std::string last_streams_json_;
+  bool compression_;
+  std::shared_ptr<const std::string> last_streams_json_;
 };
 
 }  // namespace rustla2
@@ -0,0 +1,74 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace rustla2 {
+
+WorkerPool::WorkerPool(const size_t size) {
+  const auto thread_count = std::max<size_t>(size, 1);
+  threads_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads_.emplace_back([this]() { Work(); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    stopping_ = true;
+  }
+  ready_.notify_all();
+
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkerPool::RunAll(std::vector<Task> tasks) {
+  if (tasks.empty()) {
+    return;
+  }
+
+  std::mutex done_lock;
+  std::condition_variable done;
+  size_t remaining = tasks.size();
+
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    for (auto& task : tasks) {
+      queue_.emplace_back([&, task]() {
+        task();
+
+        // notified with the lock held so |done| outlives the notification
+        std::lock_guard<std::mutex> guard(done_lock);
+        if (--remaining == 0) {
+          done.notify_one();
+        }
+      });
+    }
+  }
+  ready_.notify_all();
+
+  std::unique_lock<std::mutex> lock(done_lock);
+  done.wait(lock, [&]() { return remaining == 0; });
+}
+
+void WorkerPool::Work() {
+  std::unique_lock<std::mutex> lock(lock_);
+  while (true) {
+    ready_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return;
+    }
+
+    auto task = std::move(queue_.front());
+    queue_.pop_front();
+
+    lock.unlock();
+    task();
+    lock.lock();
+  }
+}
+
+}  // namespace rustla2
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rustla2 {
+
+/**
+ * Fixed set of threads started once and fed batches of tasks, so callers that
+ * fan work out on every tick don't pay for creating and joining threads each
+ * time.
+ */
+class WorkerPool {
+ public:
+  using Task = std::function<void()>;
+
+  explicit WorkerPool(const size_t size);
+
+  // Finishes queued tasks before returning.
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  /**
+   * Run every task in |tasks| on the pool and return once all of them have
+   * finished. Tasks may capture the caller's locals by reference.
+   */
+  void RunAll(std::vector<Task> tasks);
+
+  size_t GetSize() const { return threads_.size(); }
+
+ private:
+  void Work();
+
+  std::mutex lock_;
+  std::condition_variable ready_;
+  bool stopping_{false};
+  std::deque<Task> queue_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace rustla2
@@ -10,6 +10,16 @@
 namespace rustla2 {
 namespace youtube {
 
+std::string VideosResult::Video::GetID() const {
+  return json::StringRef(data_["id"]);
+}
+
+bool VideosResult::Video::IsLive() const {
+  const auto details = data_.FindMember("liveStreamingDetails");
+  return details != data_.MemberEnd() &&
+         details->value.HasMember("concurrentViewers");
+}
+
 uint64_t VideosResult::Video::GetViewers() const {
   return std::stoull(std::string(
       json::StringRef(data_["liveStreamingDetails"]["concurrentViewers"])));
@@ -36,6 +46,7 @@ std::string VideosResult::GetSchema() {
             "items": {
               "type": "object",
               "properties": {
+                "id": {"type": "string"},
                 "snippet": {
                   "type": "object",
                   "properties": {
@@ -65,24 +76,26 @@ std::string VideosResult::GetSchema() {
                       "type": "string",
                       "pattern": "^[0-9]+$"
                     }
-                  },
-                  "required": ["concurrentViewers"]
+                  }
                 }
               },
-              "required": ["snippet", "liveStreamingDetails"]
+              "required": ["id", "snippet"]
             }
           }
-        }
+        },
+        "required": ["pageInfo", "items"]
       }
     )json";
 }
 
-bool VideosResult::IsEmpty() const { return GetTotalResults() == 0; }
+bool VideosResult::IsEmpty() const { return GetSize() == 0; }
 
 uint64_t VideosResult::GetTotalResults() const {
   return GetData()["pageInfo"]["totalResults"].GetUint64();
 }
 
+size_t VideosResult::GetSize() const { return GetData()["items"].Size(); }
+
 const VideosResult::Video VideosResult::GetVideo(const size_t index) const {
   const auto& items = GetData()["items"].GetArray();
   return Video(items[index]);
@@ -116,11 +129,18 @@ std::string ErrorResult::GetMessage() const {
 }
 
 Status Client::GetVideosByID(const std::string& id, VideosResult* result) {
+  return GetVideosByIDs({id}, result);
+}
+
+Status Client::GetVideosByIDs(const std::vector<std::string>& ids,
+                              VideosResult* result) {
   std::stringstream url;
   url << "https://www.googleapis.com/youtube/v3/videos"
       << "?key=" << config_.public_api_key
-      << "&part=liveStreamingDetails,snippet"
-      << "&id=" << id;
+      << "&part=liveStreamingDetails,snippet&id=";
+  for (size_t i = 0; i < ids.size(); ++i) {
+    url << (i == 0 ? "" : ",") << ids[i];
+  }
 
   CurlRequest req(url.str());
   req.Submit();
@@ -142,7 +162,7 @@ Status Client::GetVideosByID(const std::string& id, VideosResult* result) {
     return Status::ERROR;
   }
 
-  return result->SetData(response.c_str(), response.size());
+  return result->SetData(req.TakeResponse());
 }
 
 }  // namespace youtube
@@ -2,6 +2,7 @@
 
 #include <rapidjson/document.h>
 #include <string>
+#include <vector>
 
 #include "APIClient.h"
 #include "Config.h"
@@ -10,12 +11,20 @@
 namespace rustla2 {
 namespace youtube {
 
+// most ids the videos endpoint accepts in one request
+constexpr size_t kMaxVideosPerRequest = 50;
+
 class VideosResult : public APIResult {
  public:
   class Video {
    public:
     explicit Video(const rapidjson::Value& data) : data_(data) {}
 
+    std::string GetID() const;
+
+    // false for videos that aren't, or are no longer, live streams
+    bool IsLive() const;
+
     uint64_t GetViewers() const;
 
     std::string GetMediumThumbnail() const;
@@ -30,6 +39,8 @@ class VideosResult : public APIResult {
 
   uint64_t GetTotalResults() const;
 
+  size_t GetSize() const;
+
   const VideosResult::Video GetVideo(const size_t index) const;
 };
 
@@ -52,6 +63,11 @@ class Client {
 
   Status GetVideosByID(const std::string& id, VideosResult* result);
 
+  // At most kMaxVideosPerRequest ids may be requested at once. Unknown ids
+  // are left out of the result.
+  Status GetVideosByIDs(const std::vector<std::string>& ids,
+                        VideosResult* result);
+
  private:
   ClientConfig config_;
 };
@@ -1,6 +1,9 @@
+#include <curl/curl.h>
 #include <folly/experimental/FunctionScheduler.h>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <uWS/uWS.h>
 #include <chrono>
@@ -8,10 +11,12 @@
 #include <thread>
 #include <vector>
 
+#include "Broadcaster.h"
 #include "Config.h"
 #include "DB.h"
 #include "HTTPService.h"
 #include "ServicePoller.h"
+#include "StaticAssets.h"
 #include "WSService.h"
 
 DEFINE_uint64(concurrency, 0, "Server thread count (defaults to core count)");
@@ -20,16 +25,32 @@ namespace rustla2 {
 
 class Runner {
  public:
-  Runner() : db_(new DB()) {}
+  Runner()
+      : db_(new DB()),
+        broadcaster_(new Broadcaster(db_)),
+        static_assets_(new StaticAssetStore(Config::Get().GetPublicPath())) {}
 
   void Run() {
+    // SIGHUP was blocked in main before any thread started, so it's only
+    // ever taken here.
+    std::thread reload_thread([this]() {
+      sigset_t reload_signals;
+      sigemptyset(&reload_signals);
+      sigaddset(&reload_signals, SIGHUP);
+
+      int signal;
+      while (sigwait(&reload_signals, &signal) == 0) {
+        LOG(INFO) << "reloading static assets";
+        static_assets_->Reload();
+      }
+    });
+    reload_thread.detach();
+
     ServicePoller service_poller(db_);
-    folly::FunctionScheduler scheduler;
+    std::thread service_poller_thread([&]() { service_poller.Loop(); });
+    service_poller_thread.detach();
 
-    scheduler.addFunction(
-        [&]() { service_poller.Run(); },
-        std::chrono::milliseconds(Config::Get().GetLivecheckInterval()),
-        "ServicePoller");
+    folly::FunctionScheduler scheduler;
 
     scheduler.addFunction(
         [&]() {
@@ -42,6 +63,22 @@ class Runner {
 
     scheduler.start();
 
+    // Broadcasts are built once on their own thread and queued for every hub
+    // so slow service polls can't delay them.
+    folly::FunctionScheduler broadcast_scheduler;
+
+    broadcast_scheduler.addFunction(
+        [&]() { broadcaster_->BroadcastStreams(); },
+        std::chrono::milliseconds(Config::Get().GetStreamBroadcastInterval()),
+        "StreamBroadcaster");
+
+    broadcast_scheduler.addFunction(
+        [&]() { broadcaster_->BroadcastRustlers(); },
+        std::chrono::milliseconds(Config::Get().GetRustlerBroadcastInterval()),
+        "RustlerBroadcaster");
+
+    broadcast_scheduler.start();
+
     auto concurrency = FLAGS_concurrency ? FLAGS_concurrency
                                          : std::thread::hardware_concurrency();
     LOG(INFO) << "starting " << concurrency << " server thread(s)";
@@ -58,10 +95,16 @@ class Runner {
  private:
   std::thread *CreateThread() {
     return new std::thread([&]() {
-      uWS::Hub hub;
+      // Broadcasts are compressed once by the Broadcaster without a shared
+      // window, so the server must not keep deflate context between messages.
+      const int extension_options =
+          Config::Get().GetWSCompression()
+              ? uWS::PERMESSAGE_DEFLATE | uWS::SERVER_NO_CONTEXT_TAKEOVER
+              : uWS::NO_OPTIONS;
+      uWS::Hub hub(extension_options);
 
-      WSService ws_service(db_, &hub);
-      HTTPService http_service(db_, &hub);
+      WSService ws_service(db_, broadcaster_, &hub);
+      HTTPService http_service(db_, broadcaster_, static_assets_, &hub);
 
       if (!Listen(&hub)) {
         LOG(FATAL) << "unable to listen";
@@ -88,16 +131,31 @@ class Runner {
   }
 
   std::shared_ptr<DB> db_;
+  std::shared_ptr<Broadcaster> broadcaster_;
+  std::shared_ptr<StaticAssetStore> static_assets_;
 };
 
 }  // namespace rustla2
 
 int main(int argc, char **argv) {
+  // SIGHUP reloads static assets on a thread that waits for it. Threads
+  // inherit their creator's signal mask, so it's blocked before any are
+  // started, including the DBWriter's in Runner's constructor; otherwise
+  // one of them could take the signal and be terminated by it.
+  sigset_t reload_signals;
+  sigemptyset(&reload_signals);
+  sigaddset(&reload_signals, SIGHUP);
+  pthread_sigmask(SIG_BLOCK, &reload_signals, nullptr);
+
   google::InitGoogleLogging(argv[0]);
   google::ParseCommandLineFlags(&argc, &argv, false);
 
   rustla2::Config::Get().Init(".env");
 
+  // libcurl's global state isn't thread safe to initialize lazily, and the
+  // ServicePoller makes requests from several threads at once
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+
   rustla2::Runner runner;
   runner.Run();
 }
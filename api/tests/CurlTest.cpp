@@ -10,6 +10,25 @@ TEST(CurlTest, Test) {
   req.Submit();
 
   EXPECT_EQ(req.GetResponseCode(), 200);
+  EXPECT_FALSE(req.GetResponse().empty());
+
+  const auto size = req.GetResponse().size();
+  EXPECT_EQ(req.TakeResponse().size(), size);
+  EXPECT_TRUE(req.GetResponse().empty());
+}
+
+TEST(CurlTest, TestConnectionReuse) {
+  auto &pool = CurlPool::Get();
+  CurlRequest("https://www.google.com/").Submit();
+
+  const auto reused = pool.GetReusedCount();
+  const auto handles = pool.GetHandleCount();
+  CurlRequest req("https://www.google.com/");
+  req.Submit();
+
+  EXPECT_EQ(req.GetResponseCode(), 200);
+  EXPECT_EQ(pool.GetReusedCount(), reused + 1);
+  EXPECT_EQ(pool.GetHandleCount(), handles);
 }
 
 }  // namespace rustla2
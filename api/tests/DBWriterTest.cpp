@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include <sqlite_modern_cpp.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../src/DBWriter.h"
+
+namespace rustla2 {
+
+namespace {
+
+// long enough that the writer thread never flushes during a test
+const std::chrono::milliseconds kInterval(60 * 60 * 1000);
+
+}  // namespace
+
+TEST(DBWriterTest, TestCoalesce) {
+  sqlite::database db(":memory:");
+  DBWriter writer(db, kInterval);
+
+  int a = 0;
+  int b = 0;
+  std::vector<std::string> writes;
+  writer.Enqueue(&a, [&]() {
+    writes.push_back("a1");
+    return true;
+  });
+  writer.Enqueue(&b, [&]() {
+    writes.push_back("b1");
+    return true;
+  });
+  writer.Enqueue(&a, [&]() {
+    writes.push_back("a2");
+    return true;
+  });
+  writer.Flush();
+
+  EXPECT_EQ(writes, std::vector<std::string>({"a2", "b1"}));
+
+  writes.clear();
+  writer.Flush();
+  EXPECT_TRUE(writes.empty());
+}
+
+TEST(DBWriterTest, TestKeepInsert) {
+  sqlite::database db(":memory:");
+  DBWriter writer(db, kInterval);
+
+  int a = 0;
+  std::vector<std::string> writes;
+  writer.Enqueue(&a,
+                 [&]() {
+                   writes.push_back("insert");
+                   return true;
+                 },
+                 true);
+  writer.Enqueue(&a, [&]() {
+    writes.push_back("update");
+    return true;
+  });
+  writer.Flush();
+
+  EXPECT_EQ(writes, std::vector<std::string>({"insert"}));
+}
+
+TEST(DBWriterTest, TestTransaction) {
+  sqlite::database db(":memory:");
+  db << "CREATE TABLE `test` (`id` INTEGER PRIMARY KEY);";
+
+  int keys[3];
+  {
+    DBWriter writer(db, kInterval);
+    for (int i = 0; i < 3; i++) {
+      writer.Enqueue(&keys[i], [&db, i]() {
+        db << "INSERT INTO `test` (`id`) VALUES (?);" << i;
+        return true;
+      });
+    }
+    // destroying the writer writes anything still queued
+  }
+
+  int count = 0;
+  db << "SELECT COUNT(*) FROM `test`;" >> count;
+  EXPECT_EQ(count, 3);
+}
+
+TEST(DBWriterTest, TestRequeueFailedBegin) {
+  sqlite::database db(":memory:");
+  DBWriter writer(db, kInterval);
+
+  int a = 0;
+  int runs = 0;
+  writer.Enqueue(&a, [&]() {
+    ++runs;
+    return true;
+  });
+
+  // the writer can't begin its own transaction inside this one
+  db << "BEGIN;";
+  writer.Flush();
+  EXPECT_EQ(runs, 0);
+
+  db << "COMMIT;";
+  writer.Flush();
+  EXPECT_EQ(runs, 1);
+}
+
+TEST(DBWriterTest, TestRollbackFailedCommit) {
+  sqlite::database db(":memory:");
+  db << "PRAGMA foreign_keys = ON;";
+  db << "CREATE TABLE `parent` (`id` INTEGER PRIMARY KEY);";
+  db << "CREATE TABLE `child` (`parent_id` INTEGER REFERENCES `parent` "
+        "DEFERRABLE INITIALLY DEFERRED);";
+  DBWriter writer(db, kInterval);
+
+  // deferred foreign keys are only checked, and fail, on commit
+  int a = 0;
+  uint32_t runs = 0;
+  writer.Enqueue(&a, [&]() {
+    ++runs;
+    db << "INSERT INTO `child` (`parent_id`) VALUES (1);";
+    return true;
+  });
+
+  writer.Flush();
+  EXPECT_EQ(runs, 1);
+  EXPECT_EQ(sqlite3_get_autocommit(db.connection().get()), 1);
+
+  for (uint32_t i = 1; i < DBWriter::kMaxAttempts + 1; ++i) {
+    writer.Flush();
+  }
+  EXPECT_EQ(runs, DBWriter::kMaxAttempts);
+
+  int count = -1;
+  db << "SELECT COUNT(*) FROM `child`;" >> count;
+  EXPECT_EQ(count, 0);
+}
+
+TEST(DBWriterTest, TestRollbackCallback) {
+  sqlite::database db(":memory:");
+  db << "PRAGMA foreign_keys = ON;";
+  db << "CREATE TABLE `parent` (`id` INTEGER PRIMARY KEY);";
+  db << "CREATE TABLE `child` (`parent_id` INTEGER REFERENCES `parent` "
+        "DEFERRABLE INITIALLY DEFERRED);";
+  DBWriter writer(db, kInterval);
+
+  int a = 0;
+  int b = 0;
+  uint32_t rollbacks = 0;
+  writer.Enqueue(&a, []() { return true; }, false, [&]() { ++rollbacks; });
+  writer.Enqueue(&b,
+                 [&]() {
+                   db << "INSERT INTO `child` (`parent_id`) VALUES (1);";
+                   return true;
+                 });
+  writer.Flush();
+  EXPECT_EQ(rollbacks, 1);
+
+  // not called once the write commits
+  db << "INSERT INTO `parent` (`id`) VALUES (1);";
+  writer.Flush();
+  EXPECT_EQ(rollbacks, 1);
+}
+
+TEST(DBWriterTest, TestWriteNow) {
+  sqlite::database db(":memory:");
+  DBWriter writer(db, kInterval);
+
+  int a = 0;
+  int b = 0;
+  std::vector<std::string> writes;
+  writer.Enqueue(&b, [&]() {
+    writes.push_back("b");
+    return true;
+  });
+
+  EXPECT_TRUE(writer.WriteNow(&a, [&]() {
+    writes.push_back("a");
+    return true;
+  }));
+  EXPECT_EQ(writes, std::vector<std::string>({"b", "a"}));
+
+  EXPECT_FALSE(writer.WriteNow(&a, []() { return false; }));
+}
+
+}  // namespace rustla2
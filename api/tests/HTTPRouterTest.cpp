@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <uWS/uWS.h>
 #include <chrono>
+#include <string>
 
 #include "../src/HTTPRequest.h"
 #include "../src/HTTPRouter.h"
@@ -10,6 +11,7 @@ namespace rustla2 {
 namespace {
 
 constexpr uWS::HttpMethod GET = uWS::HttpMethod::METHOD_GET;
+constexpr uWS::HttpMethod POST = uWS::HttpMethod::METHOD_POST;
 
 std::function<void(const HTTPRouteHandler &handler)> GetHandler() {
   return [](const HTTPRouteHandler &handler) {
@@ -62,6 +64,69 @@ TEST(HTTPRouterTest, TestWildSubpath) {
   EXPECT_EQ(count, 2);
 }
 
+TEST(HTTPRouterTest, TestMethod) {
+  rustla2::HTTPRouter router;
+  uint64_t get_count = 0;
+  uint64_t post_count = 0;
+
+  router.Get("/test",
+             [&](uWS::HttpResponse *res, HTTPRequest *req) { ++get_count; });
+  router.Post("/test",
+              [&](uWS::HttpResponse *res, HTTPRequest *req) { ++post_count; });
+  router.Get("/wild/**",
+             [&](uWS::HttpResponse *res, HTTPRequest *req) { ++get_count; });
+
+  EXPECT_TRUE(router.Dispatch("/test", GET, GetHandler()));
+  EXPECT_TRUE(router.Dispatch("/test", POST, GetHandler()));
+  EXPECT_TRUE(router.Dispatch("/wild/test/path", GET, GetHandler()));
+  EXPECT_FALSE(router.Dispatch("/wild/test/path", POST, GetHandler()));
+
+  EXPECT_EQ(get_count, 2);
+  EXPECT_EQ(post_count, 1);
+}
+
+TEST(HTTPRouterTest, TestExactBeforeWild) {
+  rustla2::HTTPRouter router;
+  uint64_t exact_count = 0;
+  uint64_t wild_count = 0;
+
+  router.Get("/some/*",
+             [&](uWS::HttpResponse *res, HTTPRequest *req) { ++wild_count; });
+  router.Get("/some/path",
+             [&](uWS::HttpResponse *res, HTTPRequest *req) { ++exact_count; });
+  router.Get("/some/path/*/end",
+             [&](uWS::HttpResponse *res, HTTPRequest *req) { ++wild_count; });
+  router.Get("/some/*/*/other",
+             [&](uWS::HttpResponse *res, HTTPRequest *req) { ++wild_count; });
+
+  EXPECT_TRUE(router.Dispatch("/some/path", GET, GetHandler()));
+  EXPECT_TRUE(router.Dispatch("/some/other", GET, GetHandler()));
+  EXPECT_TRUE(router.Dispatch("/some/path/test/end", GET, GetHandler()));
+  // backtracks out of the exact branch when it doesn't lead to a route
+  EXPECT_TRUE(router.Dispatch("/some/path/test/other", GET, GetHandler()));
+  EXPECT_FALSE(router.Dispatch("/some/path/test", GET, GetHandler()));
+
+  EXPECT_EQ(exact_count, 1);
+  EXPECT_EQ(wild_count, 3);
+}
+
+TEST(HTTPRouterTest, TestManyRoutes) {
+  rustla2::HTTPRouter router;
+  uint64_t count = 0;
+
+  for (int i = 0; i < 1000; ++i) {
+    router.Get("/static/file" + std::to_string(i) + ".js",
+               [&](uWS::HttpResponse *res, HTTPRequest *req) { ++count; });
+  }
+
+  EXPECT_TRUE(router.Dispatch("/static/file0.js", GET, GetHandler()));
+  EXPECT_TRUE(router.Dispatch("/static/file999.js", GET, GetHandler()));
+  EXPECT_FALSE(router.Dispatch("/static/file1000.js", GET, GetHandler()));
+  EXPECT_FALSE(router.Dispatch("/static", GET, GetHandler()));
+
+  EXPECT_EQ(count, 2);
+}
+
 }  // namespace rustla2
 
 int main(int argc, char **argv) {
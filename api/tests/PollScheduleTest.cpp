@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/PollSchedule.h"
+
+namespace rustla2 {
+
+namespace {
+
+const std::chrono::seconds kMinInterval(60);
+const std::chrono::seconds kMaxInterval(600);
+
+}  // namespace
+
+TEST(PollScheduleTest, TestNewStreamsDue) {
+  PollSchedule schedule(kMinInterval, kMaxInterval);
+  const PollSchedule::Clock::time_point now;
+
+  EXPECT_EQ(schedule.GetNextDue(), PollSchedule::Clock::time_point::max());
+
+  schedule.Update({{1, 1}, {2, 1}}, now);
+  EXPECT_EQ(schedule.GetSize(), 2);
+  EXPECT_EQ(schedule.GetNextDue(), now);
+
+  auto due = schedule.PopDue(now, now);
+  std::sort(due.begin(), due.end());
+  EXPECT_EQ(due, std::vector<uint64_t>({1, 2}));
+  EXPECT_TRUE(schedule.PopDue(now, now).empty());
+}
+
+TEST(PollScheduleTest, TestBackoff) {
+  PollSchedule schedule(kMinInterval, kMaxInterval);
+  auto now = PollSchedule::Clock::time_point();
+  schedule.Update({{1, 1}}, now);
+
+  std::vector<int64_t> intervals;
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(schedule.PopDue(now, now), std::vector<uint64_t>({1}));
+    const auto next = schedule.GetNextDue();
+    intervals.push_back(
+        std::chrono::duration_cast<std::chrono::seconds>(next - now).count());
+    now = next;
+  }
+
+  EXPECT_EQ(intervals, std::vector<int64_t>({120, 240, 480, 600, 600, 600}));
+}
+
+TEST(PollScheduleTest, TestMarkChanged) {
+  PollSchedule schedule(kMinInterval, kMaxInterval);
+  auto now = PollSchedule::Clock::time_point();
+  schedule.Update({{1, 1}}, now);
+
+  for (int i = 0; i < 4; ++i) {
+    schedule.PopDue(now, now);
+    now = schedule.GetNextDue();
+  }
+
+  schedule.PopDue(now, now);
+  schedule.MarkChanged(1, now);
+  EXPECT_EQ(schedule.GetNextDue(), now + kMinInterval);
+
+  // the superseded backoff doesn't check the stream a second time
+  EXPECT_EQ(schedule.PopDue(now, now + kMaxInterval),
+            std::vector<uint64_t>({1}));
+  EXPECT_TRUE(schedule.PopDue(now, now + kMinInterval).empty());
+}
+
+TEST(PollScheduleTest, TestRustlersLimitBackoff) {
+  auto settled_interval = [](const uint64_t rustlers) {
+    PollSchedule schedule(kMinInterval, kMaxInterval);
+    auto now = PollSchedule::Clock::time_point();
+    schedule.Update({{1, rustlers}}, now);
+
+    for (int i = 0; i < 6; ++i) {
+      schedule.PopDue(now, now);
+      now = schedule.GetNextDue();
+    }
+    schedule.PopDue(now, now);
+    return schedule.GetNextDue() - now;
+  };
+
+  EXPECT_EQ(settled_interval(1), kMaxInterval);
+  EXPECT_EQ(settled_interval(5), kMaxInterval / 5);
+  EXPECT_EQ(settled_interval(100), kMinInterval);
+}
+
+TEST(PollScheduleTest, TestPopDueOnce) {
+  PollSchedule schedule(kMinInterval, kMaxInterval);
+  const PollSchedule::Clock::time_point now;
+  schedule.Update({{1, 100}}, now);
+
+  // a window longer than the stream's interval still returns it once
+  EXPECT_EQ(schedule.PopDue(now, now + kMaxInterval),
+            std::vector<uint64_t>({1}));
+}
+
+TEST(PollScheduleTest, TestUpdateRemoves) {
+  PollSchedule schedule(kMinInterval, kMaxInterval);
+  const PollSchedule::Clock::time_point now;
+
+  schedule.Update({{1, 1}, {2, 1}}, now);
+  schedule.Update({{2, 1}}, now);
+  EXPECT_EQ(schedule.GetSize(), 1);
+  EXPECT_EQ(schedule.PopDue(now, now), std::vector<uint64_t>({2}));
+
+  // streams added again start over rather than reviving old heap items
+  schedule.Update({{1, 1}, {2, 1}}, now);
+  EXPECT_EQ(schedule.PopDue(now, now), std::vector<uint64_t>({1}));
+  EXPECT_TRUE(schedule.PopDue(now, now).empty());
+}
+
+}  // namespace rustla2
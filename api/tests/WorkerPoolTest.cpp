@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "../src/WorkerPool.h"
+
+namespace rustla2 {
+
+TEST(WorkerPoolTest, TestRunAll) {
+  WorkerPool pool(4);
+  EXPECT_EQ(pool.GetSize(), 4);
+
+  std::atomic<int> runs{0};
+  std::vector<WorkerPool::Task> tasks;
+  for (int i = 0; i < 100; ++i) {
+    tasks.emplace_back([&]() { ++runs; });
+  }
+  pool.RunAll(tasks);
+  EXPECT_EQ(runs, 100);
+
+  pool.RunAll({});
+  EXPECT_EQ(runs, 100);
+}
+
+TEST(WorkerPoolTest, TestReusesThreads) {
+  WorkerPool pool(2);
+
+  std::mutex lock;
+  std::set<std::thread::id> ids;
+  for (int i = 0; i < 10; ++i) {
+    std::vector<WorkerPool::Task> tasks;
+    for (int j = 0; j < 4; ++j) {
+      tasks.emplace_back([&]() {
+        std::lock_guard<std::mutex> guard(lock);
+        ids.insert(std::this_thread::get_id());
+      });
+    }
+    pool.RunAll(tasks);
+  }
+
+  EXPECT_LE(ids.size(), 2);
+}
+
+TEST(WorkerPoolTest, TestConcurrent) {
+  WorkerPool pool(4);
+
+  // would take 400ms if the tasks ran one at a time
+  std::vector<WorkerPool::Task> tasks(4, []() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  });
+  const auto start = std::chrono::steady_clock::now();
+  pool.RunAll(tasks);
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(300));
+}
+
+}  // namespace rustla2
@@ -8,11 +8,23 @@ import { setStream } from '.';
 let socket;
 export let emit; // eslint-disable-line one-var
 
+// sequence number of the last `STREAMS_SET` or `STREAMS_PATCH` applied, or
+// null while we're waiting for a full list
+let streamsSeq = null;
+
+// optional protocol features we ask the server to use
+const capabilities = [
+  'STREAMS_PATCH',
+  'RUSTLERS_BATCH',
+];
+
 // the types of payloads we can expect from the server
 export const actions = [
   'RUSTLERS_SET',
+  'RUSTLERS_BATCH',
   'STREAM_SET',
   'STREAMS_SET',
+  'STREAMS_PATCH',
   'STREAM_GET',
   'STREAM_BANNED',
 ].reduce((acc, curr) => {
@@ -35,6 +47,47 @@ const thunks = {
       });
     }
   },
+  RUSTLERS_BATCH: payload => (dispatch, getState) => {
+    const state = getState();
+    const [ counts, streams ] = payload;
+    const known = counts.filter(([ id ]) => {
+      if (!state.streams[id]) {
+        emit('getStream', id);
+        return false;
+      }
+      return true;
+    });
+    dispatch({
+      type: actions.RUSTLERS_BATCH,
+      payload: [ known, streams ],
+    });
+  },
+  STREAMS_SET: payload => (dispatch) => {
+    const [ , seq ] = payload;
+    streamsSeq = seq === undefined ? null : seq;
+    dispatch({
+      type: actions.STREAMS_SET,
+      payload,
+    });
+  },
+  STREAMS_PATCH: payload => (dispatch) => {
+    const [ seq ] = payload;
+    if (streamsSeq === null) {
+      // already waiting for a full list
+      return;
+    }
+    if (seq !== streamsSeq + 1) {
+      // we missed a patch, ask for the full list again
+      streamsSeq = null;
+      emit('getStreams');
+      return;
+    }
+    streamsSeq = seq;
+    dispatch({
+      type: actions.STREAMS_PATCH,
+      payload,
+    });
+  },
   STREAM_BANNED: () => (dispatch) => {
     browserHistory.push('/beand');
     dispatch({
@@ -62,6 +115,8 @@ export const init = store => {
 
   socket.onopen = function onopen(event) {
     pingInterval = setInterval(ping, 20000);
+    streamsSeq = null;
+    emit('setCapabilities', ...capabilities);
     messageQueue.forEach(args => emit(...args));
     messageQueue = [];
     if (wasReconnect) {
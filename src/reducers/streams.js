@@ -8,7 +8,9 @@ const {
   STREAM_GET,
   STREAM_SET,
   RUSTLERS_SET,
+  RUSTLERS_BATCH,
   STREAMS_SET,
+  STREAMS_PATCH,
 } = actions;
 
 function streamsReducer(state = INITIAL_STATE.streams, action) {
@@ -41,6 +43,27 @@ function streamsReducer(state = INITIAL_STATE.streams, action) {
         },
       };
     }
+    case RUSTLERS_BATCH: {
+      const [ counts, streams ] = action.payload;
+      const next = { ...state };
+      for (const [ id, rustlers ] of counts) {
+        // Flush streams that have no viewers left.
+        if (!rustlers) {
+          delete next[id];
+        }
+        else {
+          next[id] = {
+            ...next[id],
+            id,
+            rustlers,
+          };
+        }
+      }
+      for (const stream of streams) {
+        next[stream.id] = stream;
+      }
+      return next;
+    }
     case STREAMS_SET: {
       const [ streams ] = action.payload;
       return {
@@ -50,6 +73,16 @@ function streamsReducer(state = INITIAL_STATE.streams, action) {
         }, {}),
       };
     }
+    case STREAMS_PATCH: {
+      const [ , streams, removed ] = action.payload;
+      return {
+        ...omit(state, removed),
+        ...streams.reduce((acc, stream) => {
+          acc[stream.id] = stream;
+          return acc;
+        }, {}),
+      };
+    }
     default:
       return state;
   }